@@ -154,6 +154,8 @@ static struct s3c_sdhci_platdata hsmmc0_platdata = {
 	.max_width	= 8,
 	.host_caps	= MMC_CAP_8_BIT_DATA,
 #endif
+	/* the on-board eMMC */
+	.host_caps2	= MMC_CAP2_CACHE_CTRL | MMC_CAP2_PACKED_WR,
 };
 
 #if defined(CONFIG_S3C_DEV_HSMMC2)
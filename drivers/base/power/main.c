@@ -28,6 +28,7 @@
 #include <linux/async.h>
 #include <linux/suspend.h>
 #include <linux/timer.h>
+#include <trace/events/power.h>
 
 #include "../base.h"
 #include "power.h"
@@ -161,30 +162,46 @@ void device_pm_move_last(struct device *dev)
 	list_move_tail(&dev->power.entry, &dpm_list);
 }
 
-static ktime_t initcall_debug_start(struct device *dev)
+static char *pm_verb(int event);
+
+/**
+ * dpm_report_time - Report the time taken by a device PM callback.
+ * @dev: Device the callback was run for.
+ * @state: PM transition of the system being carried out.
+ * @noirq: Set if a "noirq" callback was run.
+ * @delta: Time spent in the callback.
+ * @error: Value returned by the callback.
+ */
+static void dpm_report_time(struct device *dev, pm_message_t state,
+			    bool noirq, ktime_t delta, int error)
 {
-	ktime_t calltime = ktime_set(0, 0);
+	trace_device_pm_report_time(dev, noirq ? "noirq" : "",
+				    ktime_to_ns(delta), pm_verb(state.event),
+				    error);
+	pm_profile_report(dev, state, noirq, delta, error);
+}
 
-	if (initcall_debug) {
+static ktime_t initcall_debug_start(struct device *dev)
+{
+	if (initcall_debug)
 		pr_info("calling  %s+ @ %i\n",
 				dev_name(dev), task_pid_nr(current));
-		calltime = ktime_get();
-	}
 
-	return calltime;
+	return ktime_get();
 }
 
 static void initcall_debug_report(struct device *dev, ktime_t calltime,
-				  int error)
+				  pm_message_t state, int error)
 {
 	ktime_t delta, rettime;
 
-	if (initcall_debug) {
-		rettime = ktime_get();
-		delta = ktime_sub(rettime, calltime);
+	rettime = ktime_get();
+	delta = ktime_sub(rettime, calltime);
+	if (initcall_debug)
 		pr_info("call %s+ returned %d after %Ld usecs\n", dev_name(dev),
 			error, (unsigned long long)ktime_to_ns(delta) >> 10);
-	}
+
+	dpm_report_time(dev, state, false, delta, error);
 }
 
 /**
@@ -274,7 +291,7 @@ static int pm_op(struct device *dev,
 		error = -EINVAL;
 	}
 
-	initcall_debug_report(dev, calltime, error);
+	initcall_debug_report(dev, calltime, state, error);
 
 	return error;
 }
@@ -293,14 +310,13 @@ static int pm_noirq_op(struct device *dev,
 			pm_message_t state)
 {
 	int error = 0;
-	ktime_t calltime = ktime_set(0, 0), delta, rettime;
+	ktime_t calltime, delta, rettime;
 
-	if (initcall_debug) {
+	if (initcall_debug)
 		pr_info("calling  %s+ @ %i, parent: %s\n",
 				dev_name(dev), task_pid_nr(current),
 				dev->parent ? dev_name(dev->parent) : "none");
-		calltime = ktime_get();
-	}
+	calltime = ktime_get();
 
 	switch (state.event) {
 #ifdef CONFIG_SUSPEND
@@ -349,13 +365,14 @@ static int pm_noirq_op(struct device *dev,
 		error = -EINVAL;
 	}
 
-	if (initcall_debug) {
-		rettime = ktime_get();
-		delta = ktime_sub(rettime, calltime);
+	rettime = ktime_get();
+	delta = ktime_sub(rettime, calltime);
+	if (initcall_debug)
 		printk("initcall %s_i+ returned %d after %Ld usecs\n",
 			dev_name(dev), error,
 			(unsigned long long)ktime_to_ns(delta) >> 10);
-	}
+
+	dpm_report_time(dev, state, true, delta, error);
 
 	return error;
 }
@@ -479,6 +496,7 @@ void dpm_resume_noirq(pm_message_t state)
 	}
 	mutex_unlock(&dpm_list_mtx);
 	dpm_show_time(starttime, state, "early");
+	pm_profile_phase_done(state, true, starttime);
 	resume_device_irqs();
 }
 EXPORT_SYMBOL_GPL(dpm_resume_noirq);
@@ -486,9 +504,11 @@ EXPORT_SYMBOL_GPL(dpm_resume_noirq);
 /**
  * legacy_resume - Execute a legacy (bus or class) resume callback for device.
  * @dev: Device to resume.
+ * @state: PM transition of the system being carried out.
  * @cb: Resume callback to execute.
  */
-static int legacy_resume(struct device *dev, int (*cb)(struct device *dev))
+static int legacy_resume(struct device *dev, pm_message_t state,
+			 int (*cb)(struct device *dev))
 {
 	int error;
 	ktime_t calltime;
@@ -498,7 +518,7 @@ static int legacy_resume(struct device *dev, int (*cb)(struct device *dev))
 	error = cb(dev);
 	suspend_report_result(cb, error);
 
-	initcall_debug_report(dev, calltime, error);
+	initcall_debug_report(dev, calltime, state, error);
 
 	return error;
 }
@@ -547,7 +567,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 			goto End;
 		} else if (dev->class->resume) {
 			pm_dev_dbg(dev, state, "legacy class ");
-			error = legacy_resume(dev, dev->class->resume);
+			error = legacy_resume(dev, state, dev->class->resume);
 			goto End;
 		}
 	}
@@ -558,7 +578,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 			error = pm_op(dev, dev->bus->pm, state);
 		} else if (dev->bus->resume) {
 			pm_dev_dbg(dev, state, "legacy ");
-			error = legacy_resume(dev, dev->bus->resume);
+			error = legacy_resume(dev, state, dev->bus->resume);
 		}
 	}
 
@@ -661,6 +681,7 @@ void dpm_resume(pm_message_t state)
 	mutex_unlock(&dpm_list_mtx);
 	async_synchronize_full();
 	dpm_show_time(starttime, state, NULL);
+	pm_profile_phase_done(state, false, starttime);
 }
 
 /**
@@ -833,10 +854,12 @@ int dpm_suspend_noirq(pm_message_t state)
 		put_device(dev);
 	}
 	mutex_unlock(&dpm_list_mtx);
-	if (error)
+	if (error) {
 		dpm_resume_noirq(resume_event(state));
-	else
+	} else {
 		dpm_show_time(starttime, state, "late");
+		pm_profile_phase_done(state, true, starttime);
+	}
 	return error;
 }
 EXPORT_SYMBOL_GPL(dpm_suspend_noirq);
@@ -858,7 +881,7 @@ static int legacy_suspend(struct device *dev, pm_message_t state,
 	error = cb(dev, state);
 	suspend_report_result(cb, error);
 
-	initcall_debug_report(dev, calltime, error);
+	initcall_debug_report(dev, calltime, state, error);
 
 	return error;
 }
@@ -1009,8 +1032,10 @@ int dpm_suspend(pm_message_t state)
 	async_synchronize_full();
 	if (!error)
 		error = async_error;
-	if (!error)
+	if (!error) {
 		dpm_show_time(starttime, state, NULL);
+		pm_profile_phase_done(state, false, starttime);
+	}
 	return error;
 }
 
@@ -1122,6 +1147,7 @@ int dpm_suspend_start(pm_message_t state)
 {
 	int error;
 
+	pm_profile_start_cycle();
 	error = dpm_prepare(state);
 	if (!error)
 		error = dpm_suspend(state);
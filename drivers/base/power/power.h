@@ -30,6 +30,21 @@ extern void device_pm_move_before(struct device *, struct device *);
 extern void device_pm_move_after(struct device *, struct device *);
 extern void device_pm_move_last(struct device *);
 
+/* drivers/base/power/profile.c */
+#ifdef CONFIG_PM_SLEEP_PROFILE
+extern void pm_profile_start_cycle(void);
+extern void pm_profile_report(struct device *dev, pm_message_t state,
+			      bool noirq, ktime_t delta, int error);
+extern void pm_profile_phase_done(pm_message_t state, bool noirq,
+				  ktime_t starttime);
+#else
+static inline void pm_profile_start_cycle(void) {}
+static inline void pm_profile_report(struct device *dev, pm_message_t state,
+				     bool noirq, ktime_t delta, int error) {}
+static inline void pm_profile_phase_done(pm_message_t state, bool noirq,
+					 ktime_t starttime) {}
+#endif
+
 #else /* !CONFIG_PM_SLEEP */
 
 static inline void device_pm_init(struct device *dev)
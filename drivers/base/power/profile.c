@@ -0,0 +1,351 @@
+/*
+ * drivers/base/power/profile.c - Per-device suspend/resume latency profiler.
+ *
+ * Every device PM callback that takes longer than threshold_us (or fails)
+ * is logged, tagged with the suspend cycle it ran in, to a ring buffer that
+ * is kept across cycles.  The total time of each phase is kept for the last
+ * few cycles as well.  Everything is exposed under debugfs/pm_profile:
+ *
+ *  log            - the raw ring, oldest entry first
+ *  cycles         - per-phase totals of recent cycles
+ *  slowest        - devices with the most callback time over the last
+ *                   summary_cycles cycles
+ *  threshold_us   - minimum callback time that gets logged
+ *  summary_cycles - number of cycles covered by "slowest"
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/device.h>
+#include <linux/hrtimer.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+#include "power.h"
+
+#define PM_PROFILE_LOG_LEN	(1 << CONFIG_PM_SLEEP_PROFILE_SHIFT)
+#define PM_PROFILE_CYCLES	16
+#define PM_PROFILE_NAME_LEN	32
+#define PM_PROFILE_TOP		20
+
+enum {
+	PM_PROFILE_SUSPEND,
+	PM_PROFILE_SUSPEND_NOIRQ,
+	PM_PROFILE_RESUME_NOIRQ,
+	PM_PROFILE_RESUME,
+	PM_PROFILE_NR_PHASES,
+};
+
+static const char * const pm_profile_phase_names[PM_PROFILE_NR_PHASES] = {
+	[PM_PROFILE_SUSPEND]		= "suspend",
+	[PM_PROFILE_SUSPEND_NOIRQ]	= "suspend_noirq",
+	[PM_PROFILE_RESUME_NOIRQ]	= "resume_noirq",
+	[PM_PROFILE_RESUME]		= "resume",
+};
+
+struct pm_profile_entry {
+	char name[PM_PROFILE_NAME_LEN];
+	unsigned int cycle;
+	u32 usecs;
+	int error;
+	u8 phase;
+};
+
+struct pm_profile_cycle {
+	unsigned int cycle;
+	u32 usecs[PM_PROFILE_NR_PHASES];
+};
+
+static struct pm_profile_entry pm_profile_log[PM_PROFILE_LOG_LEN];
+static unsigned int pm_profile_head;	/* entries logged since boot */
+static struct pm_profile_cycle pm_profile_cycles[PM_PROFILE_CYCLES];
+static unsigned int pm_profile_cycle;	/* current cycle, 0 before the first */
+static DEFINE_SPINLOCK(pm_profile_lock);
+
+static u32 threshold_us = 500;
+static u32 summary_cycles = 10;
+
+static int pm_profile_phase(pm_message_t state, bool noirq)
+{
+	bool resume = state.event & (PM_EVENT_RESUME | PM_EVENT_THAW |
+				     PM_EVENT_RESTORE | PM_EVENT_RECOVER);
+
+	if (resume)
+		return noirq ? PM_PROFILE_RESUME_NOIRQ : PM_PROFILE_RESUME;
+	return noirq ? PM_PROFILE_SUSPEND_NOIRQ : PM_PROFILE_SUSPEND;
+}
+
+/**
+ * pm_profile_start_cycle - Start accounting a new suspend cycle.
+ */
+void pm_profile_start_cycle(void)
+{
+	struct pm_profile_cycle *c;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pm_profile_lock, flags);
+	c = &pm_profile_cycles[++pm_profile_cycle % PM_PROFILE_CYCLES];
+	memset(c, 0, sizeof(*c));
+	c->cycle = pm_profile_cycle;
+	spin_unlock_irqrestore(&pm_profile_lock, flags);
+}
+
+/**
+ * pm_profile_report - Log the time taken by one device PM callback.
+ * @dev: Device the callback was run for.
+ * @state: PM transition of the system being carried out.
+ * @noirq: Set for "noirq" callbacks.
+ * @delta: Time spent in the callback.
+ * @error: Value returned by the callback.
+ */
+void pm_profile_report(struct device *dev, pm_message_t state, bool noirq,
+		       ktime_t delta, int error)
+{
+	struct pm_profile_entry *e;
+	unsigned long flags;
+	s64 usecs = ktime_to_us(delta);
+
+	if (usecs < threshold_us && !error)
+		return;
+
+	spin_lock_irqsave(&pm_profile_lock, flags);
+	e = &pm_profile_log[pm_profile_head++ % PM_PROFILE_LOG_LEN];
+	strlcpy(e->name, dev_name(dev), sizeof(e->name));
+	e->cycle = pm_profile_cycle;
+	e->usecs = min_t(s64, usecs, (u32)~0U);
+	e->error = error;
+	e->phase = pm_profile_phase(state, noirq);
+	spin_unlock_irqrestore(&pm_profile_lock, flags);
+}
+
+/**
+ * pm_profile_phase_done - Record the total time of a suspend/resume phase.
+ * @state: PM transition of the system being carried out.
+ * @noirq: Set for the "noirq" phases.
+ * @starttime: Time the phase was started.
+ */
+void pm_profile_phase_done(pm_message_t state, bool noirq, ktime_t starttime)
+{
+	struct pm_profile_cycle *c;
+	unsigned long flags;
+	s64 usecs = ktime_to_us(ktime_sub(ktime_get(), starttime));
+
+	usecs = min_t(s64, usecs, (u32)~0U);
+
+	spin_lock_irqsave(&pm_profile_lock, flags);
+	c = &pm_profile_cycles[pm_profile_cycle % PM_PROFILE_CYCLES];
+	c->usecs[pm_profile_phase(state, noirq)] = usecs;
+	spin_unlock_irqrestore(&pm_profile_lock, flags);
+}
+
+/* First valid index into pm_profile_log, counted like pm_profile_head */
+static unsigned int pm_profile_tail(void)
+{
+	return pm_profile_head > PM_PROFILE_LOG_LEN ?
+		pm_profile_head - PM_PROFILE_LOG_LEN : 0;
+}
+
+/*
+ * Copy the logged entries of cycles @first and later, oldest first, so
+ * that they can be formatted without holding pm_profile_lock.  The copy
+ * is vmalloc()ed, as the log can be several hundred kilobytes.
+ */
+static struct pm_profile_entry *pm_profile_snapshot(unsigned int first,
+						    unsigned int *nr)
+{
+	struct pm_profile_entry *snap, *e;
+	unsigned int i, n = 0;
+
+	snap = vmalloc(PM_PROFILE_LOG_LEN * sizeof(*snap));
+	if (!snap)
+		return NULL;
+
+	spin_lock_irq(&pm_profile_lock);
+	for (i = pm_profile_tail(); i != pm_profile_head; i++) {
+		e = &pm_profile_log[i % PM_PROFILE_LOG_LEN];
+		if (e->cycle >= first)
+			snap[n++] = *e;
+	}
+	spin_unlock_irq(&pm_profile_lock);
+
+	*nr = n;
+	return snap;
+}
+
+static int pm_profile_log_show(struct seq_file *s, void *unused)
+{
+	struct pm_profile_entry *snap, *e;
+	unsigned int i, n;
+
+	snap = pm_profile_snapshot(0, &n);
+	if (!snap)
+		return -ENOMEM;
+
+	seq_printf(s, "cycle phase         usecs      error device\n");
+	for (i = 0; i < n; i++) {
+		e = &snap[i];
+		seq_printf(s, "%5u %-13s %10u %5d %s\n", e->cycle,
+			   pm_profile_phase_names[e->phase], e->usecs,
+			   e->error, e->name);
+	}
+	vfree(snap);
+	return 0;
+}
+
+static int pm_profile_cycles_show(struct seq_file *s, void *unused)
+{
+	struct pm_profile_cycle *snap, *c;
+	unsigned int i, first, last;
+	int phase;
+
+	snap = kmalloc(sizeof(pm_profile_cycles), GFP_KERNEL);
+	if (!snap)
+		return -ENOMEM;
+
+	spin_lock_irq(&pm_profile_lock);
+	memcpy(snap, pm_profile_cycles, sizeof(pm_profile_cycles));
+	last = pm_profile_cycle;
+	spin_unlock_irq(&pm_profile_lock);
+
+	seq_printf(s, "cycle");
+	for (phase = 0; phase < PM_PROFILE_NR_PHASES; phase++)
+		seq_printf(s, " %13s", pm_profile_phase_names[phase]);
+	seq_printf(s, "\n");
+
+	first = last >= PM_PROFILE_CYCLES ? last - PM_PROFILE_CYCLES + 1 : 1;
+	for (i = first; i <= last; i++) {
+		c = &snap[i % PM_PROFILE_CYCLES];
+		seq_printf(s, "%5u", c->cycle);
+		for (phase = 0; phase < PM_PROFILE_NR_PHASES; phase++)
+			seq_printf(s, " %13u", c->usecs[phase]);
+		seq_printf(s, "\n");
+	}
+	kfree(snap);
+	return 0;
+}
+
+struct pm_profile_total {
+	const char *name;
+	u64 usecs;
+	u32 max_usecs;
+	unsigned int count;
+	u8 phase;
+};
+
+/* Groups the entries of one device and phase together */
+static int pm_profile_entry_cmp(const void *a, const void *b)
+{
+	const struct pm_profile_entry *ea = a, *eb = b;
+
+	if (ea->phase != eb->phase)
+		return ea->phase < eb->phase ? -1 : 1;
+	return strcmp(ea->name, eb->name);
+}
+
+static int pm_profile_total_cmp(const void *a, const void *b)
+{
+	const struct pm_profile_total *ta = a, *tb = b;
+
+	if (ta->usecs == tb->usecs)
+		return 0;
+	return ta->usecs < tb->usecs ? 1 : -1;
+}
+
+static int pm_profile_slowest_show(struct seq_file *s, void *unused)
+{
+	struct pm_profile_total *totals = NULL;
+	struct pm_profile_entry *snap, *e;
+	unsigned int i, first, last, nr_entries, n = 0;
+	int ret = 0;
+
+	last = ACCESS_ONCE(pm_profile_cycle);
+	first = last > summary_cycles ? last - summary_cycles + 1 : 0;
+	snap = pm_profile_snapshot(first, &nr_entries);
+	if (!snap)
+		return -ENOMEM;
+	if (nr_entries) {
+		totals = vzalloc(nr_entries * sizeof(*totals));
+		if (!totals) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
+	sort(snap, nr_entries, sizeof(*snap), pm_profile_entry_cmp, NULL);
+	for (i = 0; i < nr_entries; i++) {
+		e = &snap[i];
+		if (!n || totals[n - 1].phase != e->phase ||
+		    strcmp(totals[n - 1].name, e->name)) {
+			totals[n].name = e->name;
+			totals[n].phase = e->phase;
+			n++;
+		}
+		totals[n - 1].usecs += e->usecs;
+		totals[n - 1].max_usecs = max(totals[n - 1].max_usecs,
+					      e->usecs);
+		totals[n - 1].count++;
+	}
+
+	sort(totals, n, sizeof(*totals), pm_profile_total_cmp, NULL);
+
+	seq_printf(s, "cycles %u-%u, callbacks over %u us\n",
+		   first ? first : 1, last, threshold_us);
+	seq_printf(s, "phase         count   total_us     avg_us     max_us device\n");
+	for (i = 0; i < min_t(unsigned int, n, PM_PROFILE_TOP); i++)
+		seq_printf(s, "%-13s %5u %10llu %10llu %10u %s\n",
+			   pm_profile_phase_names[totals[i].phase],
+			   totals[i].count, totals[i].usecs,
+			   div_u64(totals[i].usecs, totals[i].count),
+			   totals[i].max_usecs, totals[i].name);
+
+	vfree(totals);
+out:
+	vfree(snap);
+	return ret;
+}
+
+#define PM_PROFILE_FOPS(__name)						\
+static int __name##_open(struct inode *inode, struct file *file)	\
+{									\
+	return single_open(file, __name##_show, NULL);			\
+}									\
+									\
+static const struct file_operations __name##_fops = {			\
+	.open		= __name##_open,				\
+	.read		= seq_read,					\
+	.llseek		= seq_lseek,					\
+	.release	= single_release,				\
+}
+
+PM_PROFILE_FOPS(pm_profile_log);
+PM_PROFILE_FOPS(pm_profile_cycles);
+PM_PROFILE_FOPS(pm_profile_slowest);
+
+static int __init pm_profile_debug_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("pm_profile", NULL);
+	if (!dir) {
+		pr_err("Failed to create pm_profile debug directory\n");
+		return -ENOMEM;
+	}
+
+	debugfs_create_file("log", 0444, dir, NULL, &pm_profile_log_fops);
+	debugfs_create_file("cycles", 0444, dir, NULL, &pm_profile_cycles_fops);
+	debugfs_create_file("slowest", 0444, dir, NULL,
+			    &pm_profile_slowest_fops);
+	debugfs_create_u32("threshold_us", 0644, dir, &threshold_us);
+	debugfs_create_u32("summary_cycles", 0644, dir, &summary_cycles);
+
+	return 0;
+}
+
+late_initcall(pm_profile_debug_init);
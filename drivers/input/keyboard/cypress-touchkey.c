@@ -547,6 +547,7 @@ static int cypress_touchkey_probe(struct i2c_client *client,
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	devdata->early_suspend.suspend = cypress_touchkey_early_suspend;
 	devdata->early_suspend.resume = cypress_touchkey_early_resume;
+	devdata->early_suspend.async = true;
 #endif
 	register_early_suspend(&devdata->early_suspend);
 
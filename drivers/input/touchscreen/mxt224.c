@@ -581,6 +581,7 @@ static int __devinit mxt224_probe(struct i2c_client *client,
 	data->early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN + 1;
 	data->early_suspend.suspend = mxt224_early_suspend;
 	data->early_suspend.resume = mxt224_late_resume;
+	data->early_suspend.async = true;
 	register_early_suspend(&data->early_suspend);
 #endif
 
@@ -745,6 +745,78 @@ static int mmc_test_simple_transfer(struct mmc_test_card *test,
 	return mmc_test_check_result(test, &mrq);
 }
 
+/**
+ * struct mmc_test_async_req - a transfer issued through mmc_start_req().
+ * @areq: async request handed to the core
+ * @test: test the request belongs to
+ * @mrq: the request itself
+ * @cmd: data transfer command
+ * @stop: stop command
+ * @data: data descriptor
+ */
+struct mmc_test_async_req {
+	struct mmc_async_req areq;
+	struct mmc_test_card *test;
+	struct mmc_request mrq;
+	struct mmc_command cmd;
+	struct mmc_command stop;
+	struct mmc_data data;
+};
+
+static int mmc_test_check_result_async(struct mmc_card *card,
+				       struct mmc_async_req *areq)
+{
+	struct mmc_test_async_req *rq =
+		container_of(areq, struct mmc_test_async_req, areq);
+
+	mmc_test_wait_busy(rq->test);
+
+	return mmc_test_check_result(rq->test, areq->mrq);
+}
+
+/*
+ * Issue count back to back transfers of the same buffer to consecutive
+ * addresses, preparing each request while the previous one is running.
+ */
+static int mmc_test_nonblock_transfer(struct mmc_test_card *test,
+	struct scatterlist *sg, unsigned sg_len, unsigned dev_addr,
+	unsigned blocks, unsigned blksz, unsigned count, int write)
+{
+	struct mmc_test_async_req *rqs, *rq;
+	unsigned i;
+	int ret = 0;
+
+	rqs = kzalloc(2 * sizeof(*rqs), GFP_KERNEL);
+	if (!rqs)
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++) {
+		rq = &rqs[i & 1];
+		memset(rq, 0, sizeof(*rq));
+
+		rq->test = test;
+		rq->mrq.cmd = &rq->cmd;
+		rq->mrq.data = &rq->data;
+		rq->mrq.stop = &rq->stop;
+		rq->areq.mrq = &rq->mrq;
+		rq->areq.err_check = mmc_test_check_result_async;
+
+		mmc_test_prepare_mrq(test, &rq->mrq, sg, sg_len, dev_addr,
+			blocks, blksz, write);
+
+		mmc_start_req(test->card->host, &rq->areq, &ret);
+		if (ret)
+			goto out;
+
+		dev_addr += blocks * blksz >> 9;
+	}
+
+	mmc_start_req(test->card->host, NULL, &ret);
+out:
+	kfree(rqs);
+	return ret;
+}
+
 /*
  * Tests a transfer where the card will fail completely or partly
  */
@@ -1954,6 +2026,71 @@ static int mmc_test_large_seq_write_perf(struct mmc_test_card *test)
 	return mmc_test_large_seq_perf(test, 1);
 }
 
+/*
+ * Consecutive transfer performance by transfer size, first waiting for each
+ * request in turn and then keeping the next request prepared while the
+ * current one is on the bus.
+ */
+static int mmc_test_nonblock_perf(struct mmc_test_card *test, int write)
+{
+	struct mmc_test_area *t = &test->area;
+	unsigned long sz;
+	unsigned int dev_addr, i, cnt;
+	struct timespec ts1, ts2;
+	int ret, nonblock;
+
+	for (sz = 4096; sz <= t->max_tfr; sz <<= 1) {
+		ret = mmc_test_area_map(test, sz, 0);
+		if (ret)
+			return ret;
+
+		cnt = t->max_sz / sz;
+		for (nonblock = 0; nonblock < 2; nonblock++) {
+			dev_addr = t->dev_addr;
+			getnstimeofday(&ts1);
+			if (nonblock) {
+				ret = mmc_test_nonblock_transfer(test, t->sg,
+					t->sg_len, dev_addr, t->blocks, 512,
+					cnt, write);
+			} else {
+				for (i = 0; i < cnt; i++) {
+					ret = mmc_test_area_transfer(test,
+							dev_addr, write);
+					if (ret)
+						break;
+					dev_addr += sz >> 9;
+				}
+			}
+			if (ret)
+				return ret;
+			getnstimeofday(&ts2);
+
+			printk(KERN_INFO "%s: %s requests:\n",
+			       mmc_hostname(test->card->host),
+			       nonblock ? "Non-blocking" : "Blocking");
+			mmc_test_print_avg_rate(test, sz, cnt, &ts1, &ts2);
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Consecutive read performance, blocking versus non-blocking requests.
+ */
+static int mmc_test_nonblock_read_perf(struct mmc_test_card *test)
+{
+	return mmc_test_nonblock_perf(test, 0);
+}
+
+/*
+ * Consecutive write performance, blocking versus non-blocking requests.
+ */
+static int mmc_test_nonblock_write_perf(struct mmc_test_card *test)
+{
+	return mmc_test_nonblock_perf(test, 1);
+}
+
 static const struct mmc_test_case mmc_test_cases[] = {
 	{
 		.name = "Basic write (no data verification)",
@@ -2221,6 +2358,20 @@ static const struct mmc_test_case mmc_test_cases[] = {
 		.cleanup = mmc_test_area_cleanup,
 	},
 
+	{
+		.name = "Consecutive read performance, blocking vs non-blocking",
+		.prepare = mmc_test_area_prepare,
+		.run = mmc_test_nonblock_read_perf,
+		.cleanup = mmc_test_area_cleanup,
+	},
+
+	{
+		.name = "Consecutive write performance, blocking vs non-blocking",
+		.prepare = mmc_test_area_prepare,
+		.run = mmc_test_nonblock_write_perf,
+		.cleanup = mmc_test_area_cleanup,
+	},
+
 };
 
 static DEFINE_MUTEX(mmc_test_lock);
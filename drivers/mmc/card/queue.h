@@ -4,19 +4,57 @@
 struct request;
 struct task_struct;
 
+struct mmc_blk_request {
+	struct mmc_request	mrq;
+	struct mmc_command	sbc;
+	struct mmc_command	cmd;
+	struct mmc_command	stop;
+	struct mmc_data		data;
+};
+
+struct mmc_queue_req {
+	struct request		*req;
+	struct mmc_blk_request	brq;
+	struct scatterlist	*sg;
+	char			*bounce_buf;
+	struct scatterlist	*bounce_sg;
+	unsigned int		bounce_sg_len;
+	/* the data of req goes through bounce_buf */
+	bool			bounced;
+	struct mmc_async_req	mmc_active;
+	/* requests written with one packed command, req first */
+	struct list_head	packed_list;
+	u32			*packed_cmd_hdr;
+	unsigned int		packed_blocks;
+	unsigned int		packed_num;
+	int			packed_fail_idx;
+};
+
 struct mmc_queue {
 	struct mmc_card		*card;
 	struct task_struct	*thread;
 	struct semaphore	thread_sem;
 	unsigned int		flags;
-	struct request		*req;
 	int			(*issue_fn)(struct mmc_queue *, struct request *);
 	void			*data;
 	struct request_queue	*queue;
-	struct scatterlist	*sg;
-	char			*bounce_buf;
-	struct scatterlist	*bounce_sg;
-	unsigned int		bounce_sg_len;
+	/*
+	 * While one request is on the bus (mqrq_prev) the next one
+	 * (mqrq_cur) is prepared, so each needs its own sg list and
+	 * bounce buffer.
+	 */
+	struct mmc_queue_req	mqrq[2];
+	struct mmc_queue_req	*mqrq_cur;
+	struct mmc_queue_req	*mqrq_prev;
+	/* requests to issue unpacked after a packed write failed */
+	unsigned int		no_pack_reqs;
+	/* size of the bounce buffers, 0 if the queue does not bounce */
+	unsigned int		bounce_size;
+	/* highest page the host can transfer to without bouncing */
+	unsigned long		direct_pfn;
+	/* bytes transferred through the bounce buffer, and not */
+	atomic64_t		bounced_bytes;
+	atomic64_t		direct_bytes;
 };
 
 extern int mmc_init_queue(struct mmc_queue *, struct mmc_card *, spinlock_t *,
@@ -24,9 +62,11 @@ extern int mmc_init_queue(struct mmc_queue *, struct mmc_card *, spinlock_t *,
 extern void mmc_cleanup_queue(struct mmc_queue *);
 extern void mmc_queue_suspend(struct mmc_queue *);
 extern void mmc_queue_resume(struct mmc_queue *);
+extern int mmc_packed_init(struct mmc_queue *, struct mmc_card *);
 
-extern unsigned int mmc_queue_map_sg(struct mmc_queue *);
-extern void mmc_queue_bounce_pre(struct mmc_queue *);
-extern void mmc_queue_bounce_post(struct mmc_queue *);
+extern unsigned int mmc_queue_map_sg(struct mmc_queue *,
+				     struct mmc_queue_req *);
+extern void mmc_queue_bounce_pre(struct mmc_queue_req *);
+extern void mmc_queue_bounce_post(struct mmc_queue_req *);
 
 #endif
@@ -24,6 +24,7 @@
 #include <linux/regulator/consumer.h>
 #include <linux/pm_runtime.h>
 #include <linux/wakelock.h>
+#include <linux/slab.h>
 
 #include <linux/mmc/card.h>
 #include <linux/mmc/host.h>
@@ -199,9 +200,120 @@ mmc_start_request(struct mmc_host *host, struct mmc_request *mrq)
 
 static void mmc_wait_done(struct mmc_request *mrq)
 {
-	complete(mrq->done_data);
+	complete(&mrq->completion);
 }
 
+static void __mmc_start_req(struct mmc_host *host, struct mmc_request *mrq)
+{
+	init_completion(&mrq->completion);
+	mrq->done = mmc_wait_done;
+	mmc_start_request(host, mrq);
+}
+
+static void mmc_wait_for_req_done(struct mmc_host *host,
+				  struct mmc_request *mrq)
+{
+	wait_for_completion(&mrq->completion);
+}
+
+/**
+ *	mmc_pre_req - Prepare for a new request
+ *	@host: MMC host to prepare command
+ *	@mrq: MMC request to prepare for
+ *	@is_first_req: true if there is no previous started request
+ *		       that may run in parallel to this call, otherwise false
+ *
+ *	mmc_pre_req() is called prior to mmc_start_req() to let
+ *	host prepare for the new request. Preparation of a request may be
+ *	performed while another request is running on the host.
+ */
+static void mmc_pre_req(struct mmc_host *host, struct mmc_request *mrq,
+		bool is_first_req)
+{
+	if (host->ops->pre_req)
+		host->ops->pre_req(host, mrq, is_first_req);
+}
+
+/**
+ *	mmc_post_req - Post process a completed request
+ *	@host: MMC host to post process command
+ *	@mrq: MMC request to post process for
+ *	@err: Error, if non zero, clean up any resources made in pre_req
+ *
+ *	Let the host post process a completed request. Post processing of
+ *	a request may be performed while another request is running.
+ */
+static void mmc_post_req(struct mmc_host *host, struct mmc_request *mrq,
+			 int err)
+{
+	if (host->ops->post_req)
+		host->ops->post_req(host, mrq, err);
+}
+
+/**
+ *	mmc_start_req - start a non-blocking request
+ *	@host: MMC host to start command
+ *	@areq: async request to start
+ *	@error: out parameter returns 0 for success, otherwise non zero
+ *
+ *	Start a new MMC custom command request for a host.
+ *	If there is an ongoing async request wait for completion
+ *	of that request and start the new one and return.
+ *	Does not wait for the new request to complete.
+ *
+ *	Returns the completed request, NULL in case of none completed.
+ *	Wait for an ongoing request (previously started) to complete and
+ *	return the completed request. If there is no ongoing request, NULL
+ *	is returned without waiting. NULL is not an error condition.
+ */
+struct mmc_async_req *mmc_start_req(struct mmc_host *host,
+				    struct mmc_async_req *areq, int *error)
+{
+	int err = 0;
+	struct mmc_async_req *data = host->areq;
+
+	/* Prepare a new request */
+	if (areq)
+		mmc_pre_req(host, areq->mrq, !host->areq);
+
+	if (host->areq) {
+		mmc_wait_for_req_done(host, host->areq->mrq);
+		err = host->areq->err_check(host->card, host->areq);
+		if (err) {
+			mmc_post_req(host, host->areq->mrq, 0);
+			if (areq)
+				mmc_post_req(host, areq->mrq, -EINVAL);
+
+			host->areq = NULL;
+			goto out;
+		}
+
+		/*
+		 * An exception event on a data command may mean that the
+		 * card can no longer postpone its background operations.
+		 * They are started as soon as the queue goes idle, rather
+		 * than here in the middle of the request stream.
+		 */
+		if (host->card && mmc_card_mmc(host->card) &&
+		    !mmc_host_is_spi(host) &&
+		    (host->areq->mrq->cmd->resp[0] & R1_EXCEPTION_EVENT))
+			mmc_card_set_need_bkops(host->card);
+	}
+
+	if (areq)
+		__mmc_start_req(host, areq->mrq);
+
+	if (host->areq)
+		mmc_post_req(host, host->areq->mrq, 0);
+
+	host->areq = areq;
+ out:
+	if (error)
+		*error = err;
+	return data;
+}
+EXPORT_SYMBOL(mmc_start_req);
+
 /**
  *	mmc_wait_for_req - start a request and wait for completion
  *	@host: MMC host to start command
@@ -213,14 +325,8 @@ static void mmc_wait_done(struct mmc_request *mrq)
  */
 void mmc_wait_for_req(struct mmc_host *host, struct mmc_request *mrq)
 {
-	DECLARE_COMPLETION_ONSTACK(complete);
-
-	mrq->done_data = &complete;
-	mrq->done = mmc_wait_done;
-
-	mmc_start_request(host, mrq);
-
-	wait_for_completion(&complete);
+	__mmc_start_req(host, mrq);
+	mmc_wait_for_req_done(host, mrq);
 }
 
 EXPORT_SYMBOL(mmc_wait_for_req);
@@ -1804,6 +1910,267 @@ int mmc_card_sleep(struct mmc_host *host)
 }
 EXPORT_SYMBOL(mmc_card_sleep);
 
+/*
+ * Poll the card status until it leaves the programming state.
+ */
+static int mmc_wait_prg_done(struct mmc_card *card)
+{
+	unsigned long timeout;
+	u32 status;
+	int err;
+
+	timeout = jiffies + msecs_to_jiffies(MMC_BKOPS_MAX_TIMEOUT);
+	do {
+		err = mmc_send_status(card, &status);
+		if (err)
+			return err;
+		if (R1_CURRENT_STATE(status) != R1_STATE_PRG)
+			return 0;
+		cond_resched();
+	} while (time_before(jiffies, timeout));
+
+	printk(KERN_ERR "%s: card stuck in programming state\n",
+	       mmc_hostname(card->host));
+	return -ETIMEDOUT;
+}
+
+/**
+ *	mmc_read_bkops_status - refresh the BKOPS and exception status
+ *	@card: MMC card to check
+ */
+int mmc_read_bkops_status(struct mmc_card *card)
+{
+	u8 *ext_csd;
+	int err;
+
+	ext_csd = kmalloc(512, GFP_KERNEL);
+	if (!ext_csd)
+		return -ENOMEM;
+
+	mmc_claim_host(card->host);
+	err = mmc_send_ext_csd(card, ext_csd);
+	mmc_release_host(card->host);
+	if (!err) {
+		card->ext_csd.raw_bkops_status =
+			ext_csd[EXT_CSD_BKOPS_STATUS];
+		card->ext_csd.raw_exception_status =
+			ext_csd[EXT_CSD_EXP_EVENTS_STATUS];
+	}
+
+	kfree(ext_csd);
+	return err;
+}
+EXPORT_SYMBOL(mmc_read_bkops_status);
+
+/**
+ *	mmc_start_bkops - start background operations on the card
+ *	@card: MMC card to start BKOPS on
+ *	@from_exception: called because the card raised an exception event
+ *
+ *	Outstanding operations are started without waiting for the card to
+ *	finish them, and left running until mmc_stop_bkops() interrupts them
+ *	for the next request.  From an exception event only operations the
+ *	card reports as impacting performance are started.
+ */
+void mmc_start_bkops(struct mmc_card *card, bool from_exception)
+{
+	unsigned int level;
+	int err;
+
+	BUG_ON(!card);
+
+	if (!card->ext_csd.bkops_en || mmc_card_doing_bkops(card))
+		return;
+
+	mmc_claim_host(card->host);
+
+	err = mmc_read_bkops_status(card);
+	if (err)
+		goto out_err;
+
+	level = card->ext_csd.raw_bkops_status & 0x3;
+	if (!level || (from_exception && level < EXT_CSD_BKOPS_LEVEL_2))
+		goto out;
+
+	err = __mmc_switch(card, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_BKOPS_START,
+			   1, 0, false);
+	if (err)
+		goto out_err;
+
+	card->bkops_stats.level[level]++;
+	if (from_exception)
+		card->bkops_stats.urgent_runs++;
+	else
+		card->bkops_stats.idle_starts++;
+	card->bkops_start = jiffies;
+	mmc_card_set_doing_bkops(card);
+	goto out;
+
+out_err:
+	card->bkops_stats.errors++;
+	printk(KERN_WARNING "%s: error %d starting BKOPS\n",
+	       mmc_hostname(card->host), err);
+out:
+	if (from_exception)
+		mmc_card_clr_need_bkops(card);
+	mmc_release_host(card->host);
+}
+EXPORT_SYMBOL(mmc_start_bkops);
+
+/**
+ *	mmc_stop_bkops - stop background operations started while idle
+ *	@card: MMC card to stop BKOPS on
+ *
+ *	Interrupt the operations with HPI when the card supports it,
+ *	otherwise wait for them to finish.
+ */
+int mmc_stop_bkops(struct mmc_card *card)
+{
+	u32 status;
+	int err;
+
+	BUG_ON(!card);
+
+	if (!mmc_card_doing_bkops(card))
+		return 0;
+
+	mmc_claim_host(card->host);
+
+	err = mmc_send_status(card, &status);
+	if (err)
+		goto out;
+
+	if (R1_CURRENT_STATE(status) != R1_STATE_PRG) {
+		card->bkops_stats.completed++;
+	} else if (card->ext_csd.hpi_en) {
+		err = mmc_send_hpi_cmd(card, NULL);
+		if (!err)
+			err = mmc_wait_prg_done(card);
+		if (!err)
+			card->bkops_stats.interrupted++;
+	} else {
+		err = mmc_wait_prg_done(card);
+		if (!err)
+			card->bkops_stats.completed++;
+	}
+
+out:
+	if (err) {
+		card->bkops_stats.errors++;
+		printk(KERN_WARNING "%s: error %d stopping BKOPS\n",
+		       mmc_hostname(card->host), err);
+	}
+	card->bkops_stats.busy_ms +=
+		jiffies_to_msecs(jiffies - card->bkops_start);
+	mmc_card_clr_doing_bkops(card);
+	mmc_release_host(card->host);
+	return err;
+}
+EXPORT_SYMBOL(mmc_stop_bkops);
+
+static void mmc_idle_bkops_work(struct work_struct *work)
+{
+	struct mmc_card *card =
+		container_of(work, struct mmc_card, bkops_work.work);
+
+	if (!mmc_bus_needs_resume(card->host))
+		mmc_start_bkops(card, mmc_card_need_bkops(card));
+}
+
+void mmc_init_idle_bkops(struct mmc_card *card)
+{
+	INIT_DELAYED_WORK(&card->bkops_work, mmc_idle_bkops_work);
+	card->bkops_idle_ms = MMC_BKOPS_IDLE_MS;
+}
+
+/**
+ *	mmc_schedule_idle_bkops - start BKOPS once the card has been idle
+ *	@card: MMC card that just went idle
+ *
+ *	Operations the card has asked for with an exception event are
+ *	started straight away.
+ */
+void mmc_schedule_idle_bkops(struct mmc_card *card)
+{
+	if (!card->ext_csd.bkops_en)
+		return;
+
+	if (mmc_card_need_bkops(card))
+		mmc_schedule_delayed_work(&card->bkops_work, 0);
+	else if (card->bkops_idle_ms)
+		mmc_schedule_delayed_work(&card->bkops_work,
+					  msecs_to_jiffies(card->bkops_idle_ms));
+}
+EXPORT_SYMBOL(mmc_schedule_idle_bkops);
+
+/**
+ *	mmc_cancel_idle_bkops - cancel BKOPS scheduled for idle time
+ *	@card: MMC card about to be used
+ *
+ *	Must not be called with the host claimed.
+ */
+void mmc_cancel_idle_bkops(struct mmc_card *card)
+{
+	if (card->ext_csd.bkops_en)
+		cancel_delayed_work_sync(&card->bkops_work);
+}
+EXPORT_SYMBOL(mmc_cancel_idle_bkops);
+
+/**
+ *	mmc_flush_cache - write the card's volatile cache back to flash
+ *	@card: MMC card to flush
+ *
+ *	Caller must claim host before calling this function.
+ */
+int mmc_flush_cache(struct mmc_card *card)
+{
+	int err = 0;
+
+	if (mmc_card_mmc(card) && card->ext_csd.cache_ctrl) {
+		err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
+				 EXT_CSD_FLUSH_CACHE, 1, 0);
+		if (err)
+			printk(KERN_ERR "%s: cache flush error %d\n",
+			       mmc_hostname(card->host), err);
+	}
+
+	return err;
+}
+EXPORT_SYMBOL(mmc_flush_cache);
+
+/**
+ *	mmc_cache_ctrl - turn the card's volatile cache on or off
+ *	@host: MMC host of the card
+ *	@enable: non-zero to turn the cache on
+ *
+ *	Turning the cache off makes the card flush it first.  Caller must
+ *	claim host before calling this function.
+ */
+int mmc_cache_ctrl(struct mmc_host *host, u8 enable)
+{
+	struct mmc_card *card = host->card;
+	int err = 0;
+
+	if (!(host->caps2 & MMC_CAP2_CACHE_CTRL) || !card ||
+	    !mmc_card_mmc(card) || !card->ext_csd.cache_size)
+		return 0;
+
+	enable = !!enable;
+	if (card->ext_csd.cache_ctrl != enable) {
+		err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
+				 EXT_CSD_CACHE_CTRL, enable,
+				 card->ext_csd.generic_cmd6_time);
+		if (err)
+			printk(KERN_ERR "%s: cache %s error %d\n",
+			       mmc_hostname(host), enable ? "on" : "off", err);
+		else
+			card->ext_csd.cache_ctrl = enable;
+	}
+
+	return err;
+}
+EXPORT_SYMBOL(mmc_cache_ctrl);
+
 int mmc_card_can_sleep(struct mmc_host *host)
 {
 	struct mmc_card *card = host->card;
@@ -15,6 +15,9 @@
 
 #define MMC_CMD_RETRIES        3
 
+#define MMC_BKOPS_MAX_TIMEOUT	(4 * 60 * 1000)	/* max time to wait in ms */
+#define MMC_BKOPS_IDLE_MS	2000		/* idle time before BKOPS */
+
 struct mmc_bus_ops {
 	int (*awake)(struct mmc_host *);
 	int (*sleep)(struct mmc_host *);
@@ -45,6 +48,8 @@ void mmc_set_timing(struct mmc_host *host, unsigned int timing);
 void mmc_set_driver_type(struct mmc_host *host, unsigned int drv_type);
 void mmc_power_off(struct mmc_host *host);
 
+void mmc_init_idle_bkops(struct mmc_card *card);
+
 static inline void mmc_delay(unsigned int ms)
 {
 	if (ms < 1000 / HZ) {
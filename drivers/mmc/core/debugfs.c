@@ -284,6 +284,54 @@ static const struct file_operations mmc_dbg_ext_csd_fops = {
 	.llseek		= default_llseek,
 };
 
+static int mmc_bkops_show(struct seq_file *s, void *data)
+{
+	struct mmc_card *card = s->private;
+	struct mmc_bkops_stats *stats = &card->bkops_stats;
+
+	seq_printf(s, "enabled:\t%d\n", card->ext_csd.bkops_en);
+	seq_printf(s, "hpi:\t\t%d\n", card->ext_csd.hpi_en);
+	seq_printf(s, "doing_bkops:\t%d\n", !!mmc_card_doing_bkops(card));
+	seq_printf(s, "last_status:\t%u\n", card->ext_csd.raw_bkops_status);
+	seq_printf(s, "idle_starts:\t%u\n", stats->idle_starts);
+	seq_printf(s, "urgent_runs:\t%u\n", stats->urgent_runs);
+	seq_printf(s, "level_1:\t%u\n", stats->level[1]);
+	seq_printf(s, "level_2:\t%u\n", stats->level[2]);
+	seq_printf(s, "level_3:\t%u\n", stats->level[3]);
+	seq_printf(s, "interrupted:\t%u\n", stats->interrupted);
+	seq_printf(s, "completed:\t%u\n", stats->completed);
+	seq_printf(s, "errors:\t\t%u\n", stats->errors);
+	seq_printf(s, "busy_ms:\t%llu\n", (unsigned long long)stats->busy_ms);
+
+	return 0;
+}
+
+static int mmc_bkops_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mmc_bkops_show, inode->i_private);
+}
+
+/* Any write clears the statistics */
+static ssize_t mmc_bkops_write(struct file *file, const char __user *ubuf,
+			       size_t cnt, loff_t *ppos)
+{
+	struct mmc_card *card = ((struct seq_file *)file->private_data)->private;
+
+	mmc_claim_host(card->host);
+	memset(&card->bkops_stats, 0, sizeof(card->bkops_stats));
+	mmc_release_host(card->host);
+
+	return cnt;
+}
+
+static const struct file_operations mmc_dbg_bkops_fops = {
+	.open		= mmc_bkops_open,
+	.read		= seq_read,
+	.write		= mmc_bkops_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 void mmc_add_card_debugfs(struct mmc_card *card)
 {
 	struct mmc_host	*host = card->host;
@@ -316,6 +364,15 @@ void mmc_add_card_debugfs(struct mmc_card *card)
 					&mmc_dbg_ext_csd_fops))
 			goto err;
 
+	if (mmc_card_mmc(card) && card->ext_csd.bkops) {
+		if (!debugfs_create_file("bkops", S_IRUSR | S_IWUSR, root,
+					 card, &mmc_dbg_bkops_fops))
+			goto err;
+		if (!debugfs_create_u32("bkops_idle_ms", S_IRUSR | S_IWUSR,
+					root, &card->bkops_idle_ms))
+			goto err;
+	}
+
 	return;
 
 err:
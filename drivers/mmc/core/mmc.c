@@ -259,7 +259,7 @@ static int mmc_read_ext_csd(struct mmc_card *card, u8 *ext_csd)
 	}
 
 	card->ext_csd.rev = ext_csd[EXT_CSD_REV];
-	if (card->ext_csd.rev > 5) {
+	if (card->ext_csd.rev > 6) {
 		printk(KERN_ERR "%s: unrecognised EXT_CSD revision %d\n",
 			mmc_hostname(card->host), card->ext_csd.rev);
 		err = -EINVAL;
@@ -403,9 +403,52 @@ static int mmc_read_ext_csd(struct mmc_card *card, u8 *ext_csd)
 			ext_csd[EXT_CSD_TRIM_MULT];
 	}
 
-	if (card->ext_csd.rev >= 5)
+	if (card->ext_csd.rev >= 5) {
 		card->ext_csd.rel_param = ext_csd[EXT_CSD_WR_REL_PARAM];
 
+		/* check whether the eMMC card supports HPI */
+		if (ext_csd[EXT_CSD_HPI_FEATURES] & 0x1) {
+			card->ext_csd.hpi = 1;
+			if (ext_csd[EXT_CSD_HPI_FEATURES] & 0x2)
+				card->ext_csd.hpi_cmd = MMC_STOP_TRANSMISSION;
+			else
+				card->ext_csd.hpi_cmd = MMC_SEND_STATUS;
+		}
+	}
+
+	card->ext_csd.data_sector_size = 512;
+	if (card->ext_csd.rev >= 6) {
+		if (ext_csd[EXT_CSD_DATA_SECTOR_SIZE] & 0x1)
+			card->ext_csd.data_sector_size = 4096;
+
+		/* EXT_CSD value is in units of 10ms, but we store in ms */
+		card->ext_csd.generic_cmd6_time =
+			10 * ext_csd[EXT_CSD_GENERIC_CMD6_TIME];
+
+		card->ext_csd.cache_size =
+			ext_csd[EXT_CSD_CACHE_SIZE + 0] << 0 |
+			ext_csd[EXT_CSD_CACHE_SIZE + 1] << 8 |
+			ext_csd[EXT_CSD_CACHE_SIZE + 2] << 16 |
+			ext_csd[EXT_CSD_CACHE_SIZE + 3] << 24;
+
+		/*
+		 * BKOPS_EN is one-time programmable and left to the vendor,
+		 * so only use background operations when it is already set.
+		 */
+		if (ext_csd[EXT_CSD_BKOPS_SUPPORT] & 0x1) {
+			card->ext_csd.bkops = 1;
+			card->ext_csd.bkops_en = ext_csd[EXT_CSD_BKOPS_EN] & 0x1;
+			card->ext_csd.raw_bkops_status =
+				ext_csd[EXT_CSD_BKOPS_STATUS];
+			if (!card->ext_csd.bkops_en)
+				printk(KERN_INFO "%s: BKOPS_EN bit is not set\n",
+				       mmc_hostname(card->host));
+		}
+
+		card->ext_csd.max_packed_writes =
+			ext_csd[EXT_CSD_MAX_PACKED_WRITES];
+	}
+
 	card->ext_csd.raw_erased_mem_count = ext_csd[EXT_CSD_ERASED_MEM_CONT];
 	if (ext_csd[EXT_CSD_ERASED_MEM_CONT])
 		card->erased_byte = 0xFF;
@@ -602,6 +645,7 @@ static int mmc_init_card(struct mmc_host *host, u32 ocr,
 		card->type = MMC_TYPE_MMC;
 		card->rca = 1;
 		memcpy(card->raw_cid, cid, sizeof(card->raw_cid));
+		mmc_init_idle_bkops(card);
 	}
 
 	/*
@@ -707,6 +751,65 @@ static int mmc_init_card(struct mmc_host *host, u32 ocr,
 			goto free_card;
 	}
 
+	/*
+	 * Enable HPI so that background operations started while idle
+	 * can be interrupted when a request comes in.
+	 */
+	if (card->ext_csd.hpi) {
+		err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
+				 EXT_CSD_HPI_MGMT, 1,
+				 card->ext_csd.generic_cmd6_time);
+		if (err && err != -EBADMSG)
+			goto free_card;
+		if (err) {
+			printk(KERN_WARNING "%s: enabling HPI failed\n",
+			       mmc_hostname(card->host));
+			err = 0;
+		} else
+			card->ext_csd.hpi_en = 1;
+	}
+
+	/*
+	 * Enable the volatile cache if the host allows it.  The block
+	 * driver then has to flush it for REQ_FLUSH.
+	 */
+	if ((host->caps2 & MMC_CAP2_CACHE_CTRL) &&
+	    card->ext_csd.cache_size > 0) {
+		err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
+				 EXT_CSD_CACHE_CTRL, 1,
+				 card->ext_csd.generic_cmd6_time);
+		if (err && err != -EBADMSG)
+			goto free_card;
+		if (err) {
+			printk(KERN_WARNING "%s: enabling cache failed\n",
+			       mmc_hostname(card->host));
+			card->ext_csd.cache_ctrl = 0;
+			err = 0;
+		} else
+			card->ext_csd.cache_ctrl = 1;
+	}
+
+	/*
+	 * Packed write failures are reported through an exception event,
+	 * which has to be enabled before packed writes can be used.
+	 */
+	if ((host->caps2 & MMC_CAP2_PACKED_WR) &&
+	    card->ext_csd.max_packed_writes > 0) {
+		err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
+				 EXT_CSD_EXP_EVENTS_CTRL,
+				 EXT_CSD_PACKED_EVENT_EN,
+				 card->ext_csd.generic_cmd6_time);
+		if (err && err != -EBADMSG)
+			goto free_card;
+		if (err) {
+			printk(KERN_WARNING "%s: enabling packed event "
+			       "failed\n", mmc_hostname(card->host));
+			card->ext_csd.packed_event_en = 0;
+			err = 0;
+		} else
+			card->ext_csd.packed_event_en = 1;
+	}
+
 	/*
 	 * Activate high speed (if supported)
 	 */
@@ -865,6 +968,7 @@ static void mmc_remove(struct mmc_host *host)
 	BUG_ON(!host);
 	BUG_ON(!host->card);
 
+	mmc_cancel_idle_bkops(host->card);
 	mmc_remove_card(host->card);
 	host->card = NULL;
 }
@@ -903,16 +1007,26 @@ static void mmc_detect(struct mmc_host *host)
  */
 static int mmc_suspend(struct mmc_host *host)
 {
+	int err;
+
 	BUG_ON(!host);
 	BUG_ON(!host->card);
 
+	mmc_cancel_idle_bkops(host->card);
+
 	mmc_claim_host(host);
+	mmc_stop_bkops(host->card);
+	err = mmc_cache_ctrl(host, 0);
+	if (err)
+		goto out;
+
 	if (!mmc_host_is_spi(host))
 		mmc_deselect_cards(host);
 	host->card->state &= ~MMC_STATE_HIGHSPEED;
+out:
 	mmc_release_host(host);
 
-	return 0;
+	return err;
 }
 
 /*
@@ -527,17 +527,27 @@ static int __devinit sdhci_s3c_probe(struct platform_device *pdev)
 	host->irq = irq;
 
 	/* Setup quirks for the controller */
-	host->quirks |= SDHCI_QUIRK_NO_ENDATTR_IN_NOPDESC;
 	host->quirks |= SDHCI_QUIRK_NO_HISPD_BIT;
 	host->quirks |= SDHCI_QUIRK_BROKEN_TIMEOUT_VAL;
 	if (pdata->must_maintain_clock)
 		host->quirks |= SDHCI_QUIRK_MUST_MAINTAIN_CLOCK;
 
-#ifndef CONFIG_MMC_SDHCI_S3C_DMA
+#ifdef CONFIG_MMC_SDHCI_S3C_DMA
+
+	/* SDMA can only do 32-bit aligned addresses and sizes; ADMA2
+	 * bounces the unaligned head of a segment instead. */
+	host->quirks |= (SDHCI_QUIRK_32BIT_DMA_ADDR |
+			 SDHCI_QUIRK_32BIT_DMA_SIZE);
+
+	/* ADMA2 does not take the end attribute on a nop descriptor */
+	host->quirks |= SDHCI_QUIRK_NO_ENDATTR_IN_NOPDESC;
+
+#else
 
 	/* we currently see overruns on errors, so disable the SDMA
-	 * support as well. */
+	 * and ADMA support as well. */
 	host->quirks |= SDHCI_QUIRK_BROKEN_DMA;
+	host->quirks |= SDHCI_QUIRK_BROKEN_ADMA;
 
 	/* PIO currently has problems with multi-block IO */
 	host->quirks |= SDHCI_QUIRK_NO_MULTIBLOCK;
@@ -562,9 +572,6 @@ static int __devinit sdhci_s3c_probe(struct platform_device *pdev)
 	if (pdata->host_caps)
 		host->mmc->caps |= pdata->host_caps;
 
-	host->quirks |= (SDHCI_QUIRK_32BIT_DMA_ADDR |
-			 SDHCI_QUIRK_32BIT_DMA_SIZE);
-
 	/* HSMMC on Samsung SoCs uses SDCLK as timeout clock */
 	host->quirks |= SDHCI_QUIRK_DATA_TIMEOUT_USES_SDCLK;
 
@@ -582,6 +589,9 @@ static int __devinit sdhci_s3c_probe(struct platform_device *pdev)
 	if (pdata->host_caps)
 		host->mmc->caps |= pdata->host_caps;
 
+	if (pdata->host_caps2)
+		host->mmc->caps2 |= pdata->host_caps2;
+
 	/* Set pm_flags for built_in device */
 	host->mmc->pm_caps = MMC_PM_KEEP_POWER | MMC_PM_IGNORE_PM_NOTIFY;
 	if (pdata->built_in)
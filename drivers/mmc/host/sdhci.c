@@ -19,6 +19,8 @@
 #include <linux/dma-mapping.h>
 #include <linux/slab.h>
 #include <linux/scatterlist.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/regulator/consumer.h>
 
 #include <linux/leds.h>
@@ -426,6 +428,34 @@ static void sdhci_kunmap_atomic(void *buffer, unsigned long *flags)
 	local_irq_restore(*flags);
 }
 
+static inline enum dma_data_direction sdhci_data_dir(struct mmc_data *data)
+{
+	return (data->flags & MMC_DATA_READ) ? DMA_FROM_DEVICE : DMA_TO_DEVICE;
+}
+
+/*
+ * Map data->sg for DMA, unless sdhci_pre_req() has already done so.  While
+ * the mapping belongs to sdhci_pre_req()/sdhci_post_req(), host_cookie holds
+ * the number of mapped entries and the request path must not unmap it.
+ */
+static int sdhci_dma_map_sg(struct sdhci_host *host, struct mmc_data *data)
+{
+	if (data->host_cookie)
+		return data->host_cookie;
+
+	return dma_map_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+			  sdhci_data_dir(data));
+}
+
+static void sdhci_dma_unmap_sg(struct sdhci_host *host, struct mmc_data *data)
+{
+	if (data->host_cookie)
+		return;
+
+	dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+		     sdhci_data_dir(data));
+}
+
 static void sdhci_set_adma_desc(u8 *desc, u32 addr, int len, unsigned cmd)
 {
 	__le32 *dataddr = (__le32 __force *)(desc + 4);
@@ -440,11 +470,91 @@ static void sdhci_set_adma_desc(u8 *desc, u32 addr, int len, unsigned cmd)
 	dataddr[0] = cpu_to_le32(addr);
 }
 
+/*
+ * The descriptor table is made of pages allocated once per host.  The
+ * last descriptor of each page links to the next one, so the table
+ * can hold more entries than fit in a page without needing contiguous
+ * memory, and nothing has to be mapped for each request.
+ */
+static u8 *sdhci_adma_desc(struct sdhci_host *host, int n)
+{
+	struct sdhci_adma_page *page;
+
+	page = &host->adma_pool[n / SDHCI_ADMA_PAGE_DESCS];
+
+	return page->desc + (n % SDHCI_ADMA_PAGE_DESCS) * SDHCI_ADMA_DESC_SZ;
+}
+
+static void sdhci_free_adma_pool(struct sdhci_host *host)
+{
+	struct sdhci_adma_page *page;
+	int i;
+
+	if (host->adma_pool) {
+		for (i = 0; i < host->adma_pool_pages; i++) {
+			page = &host->adma_pool[i];
+			if (page->desc)
+				dma_free_coherent(mmc_dev(host->mmc),
+						  PAGE_SIZE, page->desc,
+						  page->addr);
+		}
+		kfree(host->adma_pool);
+	}
+
+	if (host->align_buffer)
+		dma_free_coherent(mmc_dev(host->mmc),
+				  SDHCI_ADMA_MAX_SEGS * 4,
+				  host->align_buffer, host->align_addr);
+
+	host->adma_pool = NULL;
+	host->adma_pool_pages = 0;
+	host->align_buffer = NULL;
+}
+
+static int sdhci_alloc_adma_pool(struct sdhci_host *host)
+{
+	struct device *dev = mmc_dev(host->mmc);
+	struct sdhci_adma_page *page;
+	int i;
+
+	host->adma_pool_pages = DIV_ROUND_UP(SDHCI_ADMA_DESCS,
+					     SDHCI_ADMA_PAGE_DESCS);
+	host->adma_pool = kcalloc(host->adma_pool_pages,
+				  sizeof(struct sdhci_adma_page), GFP_KERNEL);
+	if (!host->adma_pool)
+		goto fail;
+
+	for (i = 0; i < host->adma_pool_pages; i++) {
+		page = &host->adma_pool[i];
+		page->desc = dma_alloc_coherent(dev, PAGE_SIZE, &page->addr,
+						GFP_KERNEL);
+		if (!page->desc)
+			goto fail;
+		BUG_ON(page->addr & 0x3);
+
+		if (i)
+			/* link, valid */
+			sdhci_set_adma_desc(page[-1].desc +
+				SDHCI_ADMA_PAGE_DESCS * SDHCI_ADMA_DESC_SZ,
+				page->addr, 0, 0x31);
+	}
+
+	host->align_buffer = dma_alloc_coherent(dev, SDHCI_ADMA_MAX_SEGS * 4,
+						&host->align_addr, GFP_KERNEL);
+	if (!host->align_buffer)
+		goto fail;
+	BUG_ON(host->align_addr & 0x3);
+
+	return 0;
+
+fail:
+	sdhci_free_adma_pool(host);
+	return -ENOMEM;
+}
+
 static int sdhci_adma_table_pre(struct sdhci_host *host,
 	struct mmc_data *data)
 {
-	int direction;
-
 	u8 *desc;
 	u8 *align;
 	dma_addr_t addr;
@@ -452,7 +562,7 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 	int len, offset;
 
 	struct scatterlist *sg;
-	int i;
+	int i, n;
 	char *buffer;
 	unsigned long flags;
 
@@ -461,30 +571,12 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 	 * We currently guess that it is LE.
 	 */
 
-	if (data->flags & MMC_DATA_READ)
-		direction = DMA_FROM_DEVICE;
-	else
-		direction = DMA_TO_DEVICE;
-
-	/*
-	 * The ADMA descriptor table is mapped further down as we
-	 * need to fill it with data first.
-	 */
-
-	host->align_addr = dma_map_single(mmc_dev(host->mmc),
-		host->align_buffer, 128 * 4, direction);
-	if (dma_mapping_error(mmc_dev(host->mmc), host->align_addr))
-		goto fail;
-	BUG_ON(host->align_addr & 0x3);
-
-	host->sg_count = dma_map_sg(mmc_dev(host->mmc),
-		data->sg, data->sg_len, direction);
+	host->sg_count = sdhci_dma_map_sg(host, data);
 	if (host->sg_count == 0)
-		goto unmap_align;
+		return -EINVAL;
 
-	desc = host->adma_desc;
+	n = 0;
 	align = host->align_buffer;
-
 	align_addr = host->align_addr;
 
 	for_each_sg(data->sg, sg, host->sg_count, i) {
@@ -508,38 +600,39 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 			}
 
 			/* tran, valid */
-			sdhci_set_adma_desc(desc, align_addr, offset, 0x21);
+			sdhci_set_adma_desc(sdhci_adma_desc(host, n++),
+					    align_addr, offset, 0x21);
 
 			BUG_ON(offset > 65536);
 
 			align += 4;
 			align_addr += 4;
 
-			desc += 8;
-
 			addr += offset;
 			len -= offset;
+
+			host->adma_align_segs++;
+			host->adma_align_bytes += offset;
 		}
 
 		BUG_ON(len > 65536);
 
 		/* tran, valid */
-		sdhci_set_adma_desc(desc, addr, len, 0x21);
-		desc += 8;
+		sdhci_set_adma_desc(sdhci_adma_desc(host, n++), addr, len, 0x21);
 
 		/*
 		 * If this triggers then we have a calculation bug
 		 * somewhere. :/
 		 */
-		WARN_ON((desc - host->adma_desc) > (128 * 2 + 1) * 4);
+		WARN_ON(n >= SDHCI_ADMA_DESCS);
 	}
 
 	if (host->quirks & SDHCI_QUIRK_NO_ENDATTR_IN_NOPDESC) {
 		/*
 		* Mark the last descriptor as the terminating descriptor
 		*/
-		if (desc != host->adma_desc) {
-			desc -= 8;
+		if (n) {
+			desc = sdhci_adma_desc(host, n - 1);
 			desc[0] |= 0x2; /* end */
 		}
 	} else {
@@ -548,33 +641,19 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 		*/
 
 		/* nop, end, valid */
-		sdhci_set_adma_desc(desc, 0, 0, 0x3);
+		sdhci_set_adma_desc(sdhci_adma_desc(host, n), 0, 0, 0x3);
 	}
 
+	host->adma_reqs++;
+	host->adma_segs += host->sg_count;
+
 	/*
-	 * Resync align buffer as we might have changed it.
+	 * The table and the align buffer are coherent; just make sure
+	 * the writes above are done before the controller is started.
 	 */
-	if (data->flags & MMC_DATA_WRITE) {
-		dma_sync_single_for_device(mmc_dev(host->mmc),
-			host->align_addr, 128 * 4, direction);
-	}
-
-	host->adma_addr = dma_map_single(mmc_dev(host->mmc),
-		host->adma_desc, (128 * 2 + 1) * 4, DMA_TO_DEVICE);
-	if (dma_mapping_error(mmc_dev(host->mmc), host->adma_addr))
-		goto unmap_entries;
-	BUG_ON(host->adma_addr & 0x3);
+	wmb();
 
 	return 0;
-
-unmap_entries:
-	dma_unmap_sg(mmc_dev(host->mmc), data->sg,
-		data->sg_len, direction);
-unmap_align:
-	dma_unmap_single(mmc_dev(host->mmc), host->align_addr,
-		128 * 4, direction);
-fail:
-	return -EINVAL;
 }
 
 static void sdhci_adma_table_post(struct sdhci_host *host,
@@ -587,21 +666,31 @@ static void sdhci_adma_table_post(struct sdhci_host *host,
 	u8 *align;
 	char *buffer;
 	unsigned long flags;
+	bool has_unaligned = false;
 
 	if (data->flags & MMC_DATA_READ)
 		direction = DMA_FROM_DEVICE;
 	else
 		direction = DMA_TO_DEVICE;
 
-	dma_unmap_single(mmc_dev(host->mmc), host->adma_addr,
-		(128 * 2 + 1) * 4, DMA_TO_DEVICE);
-
-	dma_unmap_single(mmc_dev(host->mmc), host->align_addr,
-		128 * 4, direction);
-
 	if (data->flags & MMC_DATA_READ) {
-		dma_sync_sg_for_cpu(mmc_dev(host->mmc), data->sg,
+		for_each_sg(data->sg, sg, host->sg_count, i) {
+			if (sg_dma_address(sg) & 0x3) {
+				has_unaligned = true;
+				break;
+			}
+		}
+	}
+
+	if (has_unaligned) {
+		/*
+		 * The CPU is about to write the bounced bytes into the
+		 * buffers, so drop the mapping first even if it was made
+		 * by sdhci_pre_req().
+		 */
+		dma_unmap_sg(mmc_dev(host->mmc), data->sg,
 			data->sg_len, direction);
+		data->host_cookie = 0;
 
 		align = host->align_buffer;
 
@@ -617,10 +706,8 @@ static void sdhci_adma_table_post(struct sdhci_host *host,
 				align += 4;
 			}
 		}
-	}
-
-	dma_unmap_sg(mmc_dev(host->mmc), data->sg,
-		data->sg_len, direction);
+	} else
+		sdhci_dma_unmap_sg(host, data);
 }
 
 static u8 sdhci_calc_timeout(struct sdhci_host *host, struct mmc_command *cmd)
@@ -745,6 +832,7 @@ static void sdhci_prepare_data(struct sdhci_host *host, struct mmc_command *cmd)
 						"transfer size (%d)\n",
 						sg->length);
 					host->flags &= ~SDHCI_REQ_USE_DMA;
+					host->dma_pio_fallbacks++;
 					break;
 				}
 			}
@@ -779,6 +867,7 @@ static void sdhci_prepare_data(struct sdhci_host *host, struct mmc_command *cmd)
 					DBG("Reverting to PIO because of "
 						"bad alignment\n");
 					host->flags &= ~SDHCI_REQ_USE_DMA;
+					host->dma_pio_fallbacks++;
 					break;
 				}
 			}
@@ -796,17 +885,13 @@ static void sdhci_prepare_data(struct sdhci_host *host, struct mmc_command *cmd)
 				WARN_ON(1);
 				host->flags &= ~SDHCI_REQ_USE_DMA;
 			} else {
-				sdhci_writel(host, host->adma_addr,
+				sdhci_writel(host, host->adma_pool[0].addr,
 					SDHCI_ADMA_ADDRESS);
 			}
 		} else {
 			int sg_cnt;
 
-			sg_cnt = dma_map_sg(mmc_dev(host->mmc),
-					data->sg, data->sg_len,
-					(data->flags & MMC_DATA_READ) ?
-						DMA_FROM_DEVICE :
-						DMA_TO_DEVICE);
+			sg_cnt = sdhci_dma_map_sg(host, data);
 			if (sg_cnt == 0) {
 				/*
 				 * This only happens when someone fed
@@ -841,6 +926,13 @@ static void sdhci_prepare_data(struct sdhci_host *host, struct mmc_command *cmd)
 	if (!(host->flags & SDHCI_REQ_USE_DMA)) {
 		int flags;
 
+		/* PIO goes through the CPU, so undo any sdhci_pre_req() map */
+		if (data->host_cookie) {
+			dma_unmap_sg(mmc_dev(host->mmc), data->sg,
+				     data->sg_len, sdhci_data_dir(data));
+			data->host_cookie = 0;
+		}
+
 		flags = SG_MITER_ATOMIC;
 		if (host->data->flags & MMC_DATA_READ)
 			flags |= SG_MITER_TO_SG;
@@ -904,11 +996,8 @@ static void sdhci_finish_data(struct sdhci_host *host)
 	if (host->flags & SDHCI_REQ_USE_DMA) {
 		if (host->flags & SDHCI_USE_ADMA)
 			sdhci_adma_table_post(host, data);
-		else {
-			dma_unmap_sg(mmc_dev(host->mmc), data->sg,
-				data->sg_len, (data->flags & MMC_DATA_READ) ?
-					DMA_FROM_DEVICE : DMA_TO_DEVICE);
-		}
+		else
+			sdhci_dma_unmap_sg(host, data);
 	}
 
 	/*
@@ -1862,7 +1951,47 @@ void sdhci_adjust_cfg(struct mmc_host *mmc, int rw)
 	spin_unlock_irqrestore(&host->lock, flags);
 }
 
+/*
+ * Map the next request for DMA while the current one is still on the bus,
+ * so that the cache maintenance is off the critical path.
+ */
+static void sdhci_pre_req(struct mmc_host *mmc, struct mmc_request *mrq,
+			  bool is_first_req)
+{
+	struct sdhci_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+	int sg_count;
+
+	if (!data)
+		return;
+
+	data->host_cookie = 0;
+	if (!(host->flags & (SDHCI_USE_SDMA | SDHCI_USE_ADMA)))
+		return;
+
+	sg_count = dma_map_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+			      sdhci_data_dir(data));
+	if (sg_count > 0)
+		data->host_cookie = sg_count;
+}
+
+static void sdhci_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
+			   int err)
+{
+	struct sdhci_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (!data || !data->host_cookie)
+		return;
+
+	dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+		     sdhci_data_dir(data));
+	data->host_cookie = 0;
+}
+
 static const struct mmc_host_ops sdhci_ops = {
+	.pre_req	= sdhci_pre_req,
+	.post_req	= sdhci_post_req,
 	.request	= sdhci_request,
 	.set_ios	= sdhci_set_ios,
 	.get_ro		= sdhci_get_ro,
@@ -2104,14 +2233,16 @@ static void sdhci_cmd_irq(struct sdhci_host *host, u32 intmask)
 static void sdhci_show_adma_error(struct sdhci_host *host)
 {
 	const char *name = mmc_hostname(host->mmc);
-	u8 *desc = host->adma_desc;
+	u8 *desc;
 	__le32 *dma;
 	__le16 *len;
 	u8 attr;
+	int n;
 
 	sdhci_dumpregs(host);
 
-	while (true) {
+	for (n = 0; n < SDHCI_ADMA_DESCS; n++) {
+		desc = sdhci_adma_desc(host, n);
 		dma = (__le32 *)(desc + 4);
 		len = (__le16 *)(desc + 2);
 		attr = *desc;
@@ -2119,8 +2250,6 @@ static void sdhci_show_adma_error(struct sdhci_host *host)
 		DBG("%s: %p: DMA 0x%08x, LEN 0x%04x, Attr=0x%02x\n",
 		    name, desc, le32_to_cpu(*dma), le16_to_cpu(*len), attr);
 
-		desc += 8;
-
 		if (attr & 2)
 			break;
 	}
@@ -2395,6 +2524,49 @@ EXPORT_SYMBOL_GPL(sdhci_enable_irq_wakeups);
 
 #endif /* CONFIG_PM */
 
+#ifdef CONFIG_DEBUG_FS
+static int sdhci_dma_stats_show(struct seq_file *s, void *data)
+{
+	struct sdhci_host *host = s->private;
+
+	seq_printf(s, "adma_reqs:\t\t%lu\n", host->adma_reqs);
+	seq_printf(s, "adma_segs:\t\t%lu\n", host->adma_segs);
+	seq_printf(s, "adma_align_segs:\t%lu\n", host->adma_align_segs);
+	seq_printf(s, "adma_align_bytes:\t%lu\n", host->adma_align_bytes);
+	seq_printf(s, "pio_fallbacks:\t\t%lu\n", host->dma_pio_fallbacks);
+
+	return 0;
+}
+
+static int sdhci_dma_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sdhci_dma_stats_show, inode->i_private);
+}
+
+static const struct file_operations sdhci_dma_stats_fops = {
+	.open		= sdhci_dma_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/* Lives in the host's debugfs directory, which goes with mmc_remove_host() */
+static void sdhci_add_debugfs(struct sdhci_host *host)
+{
+	struct dentry *root = host->mmc->debugfs_root;
+
+	if (!root || !(host->flags & (SDHCI_USE_SDMA | SDHCI_USE_ADMA)))
+		return;
+
+	if (!debugfs_create_file("dma_stats", S_IRUSR, root, host,
+				 &sdhci_dma_stats_fops))
+		dev_err(mmc_dev(host->mmc),
+			"failed to initialize debugfs for dma stats\n");
+}
+#else
+static inline void sdhci_add_debugfs(struct sdhci_host *host) { }
+#endif
+
 /*****************************************************************************\
  *                                                                           *
  * Device allocation/registration                                            *
@@ -2493,14 +2665,10 @@ int sdhci_add_host(struct sdhci_host *host)
 	if (host->flags & SDHCI_USE_ADMA) {
 		/*
 		 * We need to allocate descriptors for all sg entries
-		 * (128) and potentially one alignment transfer for
-		 * each of those entries.
+		 * (SDHCI_ADMA_MAX_SEGS) and potentially one alignment
+		 * transfer for each of those entries.
 		 */
-		host->adma_desc = kmalloc((128 * 2 + 1) * 4, GFP_KERNEL);
-		host->align_buffer = kmalloc(128 * 4, GFP_KERNEL);
-		if (!host->adma_desc || !host->align_buffer) {
-			kfree(host->adma_desc);
-			kfree(host->align_buffer);
+		if (sdhci_alloc_adma_pool(host)) {
 			printk(KERN_WARNING "%s: Unable to allocate ADMA "
 				"buffers. Falling back to standard DMA.\n",
 				mmc_hostname(mmc));
@@ -2744,7 +2912,7 @@ int sdhci_add_host(struct sdhci_host *host)
 	 * can do scatter/gather or not.
 	 */
 	if (host->flags & SDHCI_USE_ADMA)
-		mmc->max_segs = 128;
+		mmc->max_segs = SDHCI_ADMA_MAX_SEGS;
 	else if (host->flags & SDHCI_USE_SDMA)
 		mmc->max_segs = 1;
 	else /* PIO */
@@ -2848,6 +3016,7 @@ int sdhci_add_host(struct sdhci_host *host)
 	mmiowb();
 
 	mmc_add_host(mmc);
+	sdhci_add_debugfs(host);
 
 	printk(KERN_INFO "%s: SDHCI controller on %s [%s] using %s\n",
 		mmc_hostname(mmc), host->hw_name, dev_name(mmc_dev(mmc)),
@@ -2866,6 +3035,7 @@ reset:
 untasklet:
 	tasklet_kill(&host->card_tasklet);
 	tasklet_kill(&host->finish_tasklet);
+	sdhci_free_adma_pool(host);
 
 	return ret;
 }
@@ -2918,11 +3088,7 @@ void sdhci_remove_host(struct sdhci_host *host, int dead)
 		regulator_put(host->vmmc);
 	}
 
-	kfree(host->adma_desc);
-	kfree(host->align_buffer);
-
-	host->adma_desc = NULL;
-	host->align_buffer = NULL;
+	sdhci_free_adma_pool(host);
 }
 
 EXPORT_SYMBOL_GPL(sdhci_remove_host);
@@ -223,6 +223,14 @@
 
 #define SDHCI_ADMA_ADDRESS	0x58
 
+/* ADMA2 32-bit descriptors */
+#define SDHCI_ADMA_DESC_SZ	8
+/* Usable descriptors per page of the table; the last one is a link */
+#define SDHCI_ADMA_PAGE_DESCS	(PAGE_SIZE / SDHCI_ADMA_DESC_SZ - 1)
+#define SDHCI_ADMA_MAX_SEGS	256
+/* A transfer and an alignment descriptor per segment, and the end */
+#define SDHCI_ADMA_DESCS	(SDHCI_ADMA_MAX_SEGS * 2 + 1)
+
 /* 60-FB reserved */
 
 #define SDHCI_SLOT_INT_STATUS	0xFC
@@ -1156,6 +1156,16 @@ struct ext4_sb_info {
 	unsigned long extent_cache_hits;
 	unsigned long extent_cache_misses;
 
+	/* delayed allocation writeback stats */
+	atomic_long_t s_da_extents;	/* extents allocated at writeback */
+	atomic_long_t s_da_blocks;	/* blocks in those extents */
+	atomic_long_t s_da_group_pa_extents; /* served from a locality group */
+
+	/* fsync stats */
+	atomic_long_t s_fsync_already_committed; /* nothing left to commit */
+	atomic_long_t s_fsync_commits;	/* had to wait for a commit */
+	atomic64_t s_fsync_commit_wait_us;
+
 	/* for buddy allocator */
 	struct ext4_group_info ***s_group_info;
 	struct inode *s_buddy_cache;
@@ -28,6 +28,7 @@
 #include <linux/writeback.h>
 #include <linux/jbd2.h>
 #include <linux/blkdev.h>
+#include <linux/ktime.h>
 
 #include "ext4.h"
 #include "ext4_jbd2.h"
@@ -169,10 +170,13 @@ int ext4_sync_file(struct file *file, int datasync)
 {
 	struct inode *inode = file->f_mapping->host;
 	struct ext4_inode_info *ei = EXT4_I(inode);
-	journal_t *journal = EXT4_SB(inode->i_sb)->s_journal;
+	struct ext4_sb_info *sbi = EXT4_SB(inode->i_sb);
+	journal_t *journal = sbi->s_journal;
 	int ret;
 	tid_t commit_tid;
 	bool needs_barrier = false;
+	bool committed;
+	ktime_t start;
 
 	J_ASSERT(ext4_journal_current_handle() == NULL);
 
@@ -215,8 +219,25 @@ int ext4_sync_file(struct file *file, int datasync)
 	if (journal->j_flags & JBD2_BARRIER &&
 	    !jbd2_trans_will_send_data_barrier(journal, commit_tid))
 		needs_barrier = true;
+
+	/*
+	 * Only for the statistics: jbd2 returns straight away for a
+	 * transaction that has already committed.
+	 */
+	read_lock(&journal->j_state_lock);
+	committed = tid_geq(journal->j_commit_sequence, commit_tid);
+	read_unlock(&journal->j_state_lock);
+
+	start = ktime_get();
 	jbd2_log_start_commit(journal, commit_tid);
 	ret = jbd2_log_wait_commit(journal, commit_tid);
+	if (committed) {
+		atomic_long_inc(&sbi->s_fsync_already_committed);
+	} else {
+		atomic_long_inc(&sbi->s_fsync_commits);
+		atomic64_add(ktime_us_delta(ktime_get(), start),
+			     &sbi->s_fsync_commit_wait_us);
+	}
 	if (needs_barrier)
 		blkdev_issue_flush(inode->i_sb->s_bdev, GFP_KERNEL, NULL);
  out:
@@ -2343,6 +2343,13 @@ static void mpage_da_map_and_submit(struct mpage_da_data *mpd)
 	}
 	BUG_ON(blks == 0);
 
+	if (mpd->b_state & (1 << BH_Delay)) {
+		struct ext4_sb_info *sbi = EXT4_SB(mpd->inode->i_sb);
+
+		atomic_long_inc(&sbi->s_da_extents);
+		atomic_long_add(blks, &sbi->s_da_blocks);
+	}
+
 	mapp = &map;
 	if (map.m_flags & EXT4_MAP_NEW) {
 		struct block_device *bdev = mpd->inode->i_sb->s_bdev;
@@ -3125,6 +3125,9 @@ static void ext4_mb_use_group_pa(struct ext4_allocation_context *ac,
 	ac->ac_status = AC_STATUS_FOUND;
 	ac->ac_pa = pa;
 
+	if (ac->ac_flags & EXT4_MB_DELALLOC_RESERVED)
+		atomic_long_inc(&EXT4_SB(ac->ac_sb)->s_da_group_pa_extents);
+
 	/* we don't correct pa_pstart or pa_plen here to avoid
 	 * possible race when the group is being loaded concurrently
 	 * instead we correct pa later, after blocks are marked
@@ -2465,6 +2465,62 @@ static ssize_t extent_cache_misses_show(struct ext4_attr *a,
 	return snprintf(buf, PAGE_SIZE, "%lu\n", sbi->extent_cache_misses);
 }
 
+static ssize_t da_extents_written_show(struct ext4_attr *a,
+				       struct ext4_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%lu\n",
+			atomic_long_read(&sbi->s_da_extents));
+}
+
+static ssize_t da_blocks_written_show(struct ext4_attr *a,
+				      struct ext4_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%lu\n",
+			atomic_long_read(&sbi->s_da_blocks));
+}
+
+static ssize_t da_avg_extent_kbytes_show(struct ext4_attr *a,
+					 struct ext4_sb_info *sbi, char *buf)
+{
+	struct super_block *sb = sbi->s_buddy_cache->i_sb;
+	unsigned long extents = atomic_long_read(&sbi->s_da_extents);
+	unsigned long blocks = atomic_long_read(&sbi->s_da_blocks);
+
+	if (!extents)
+		return snprintf(buf, PAGE_SIZE, "0\n");
+	return snprintf(buf, PAGE_SIZE, "%lu\n",
+			(blocks << (sb->s_blocksize_bits - 10)) / extents);
+}
+
+static ssize_t da_group_pa_extents_show(struct ext4_attr *a,
+					struct ext4_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%lu\n",
+			atomic_long_read(&sbi->s_da_group_pa_extents));
+}
+
+static ssize_t fsync_already_committed_show(struct ext4_attr *a,
+					    struct ext4_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%lu\n",
+			atomic_long_read(&sbi->s_fsync_already_committed));
+}
+
+static ssize_t fsync_commits_show(struct ext4_attr *a,
+				  struct ext4_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%lu\n",
+			atomic_long_read(&sbi->s_fsync_commits));
+}
+
+static ssize_t fsync_commit_wait_us_show(struct ext4_attr *a,
+					 struct ext4_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%llu\n",
+			(unsigned long long)
+			atomic64_read(&sbi->s_fsync_commit_wait_us));
+}
+
 static ssize_t inode_readahead_blks_store(struct ext4_attr *a,
 					  struct ext4_sb_info *sbi,
 					  const char *buf, size_t count)
@@ -2524,6 +2580,13 @@ EXT4_RO_ATTR(session_write_kbytes);
 EXT4_RO_ATTR(lifetime_write_kbytes);
 EXT4_RO_ATTR(extent_cache_hits);
 EXT4_RO_ATTR(extent_cache_misses);
+EXT4_RO_ATTR(da_extents_written);
+EXT4_RO_ATTR(da_blocks_written);
+EXT4_RO_ATTR(da_avg_extent_kbytes);
+EXT4_RO_ATTR(da_group_pa_extents);
+EXT4_RO_ATTR(fsync_already_committed);
+EXT4_RO_ATTR(fsync_commits);
+EXT4_RO_ATTR(fsync_commit_wait_us);
 EXT4_ATTR_OFFSET(inode_readahead_blks, 0644, sbi_ui_show,
 		 inode_readahead_blks_store, s_inode_readahead_blks);
 EXT4_RW_ATTR_SBI_UI(inode_goal, s_inode_goal);
@@ -2541,6 +2604,13 @@ static struct attribute *ext4_attrs[] = {
 	ATTR_LIST(lifetime_write_kbytes),
 	ATTR_LIST(extent_cache_hits),
 	ATTR_LIST(extent_cache_misses),
+	ATTR_LIST(da_extents_written),
+	ATTR_LIST(da_blocks_written),
+	ATTR_LIST(da_avg_extent_kbytes),
+	ATTR_LIST(da_group_pa_extents),
+	ATTR_LIST(fsync_already_committed),
+	ATTR_LIST(fsync_commits),
+	ATTR_LIST(fsync_commit_wait_us),
 	ATTR_LIST(inode_readahead_blks),
 	ATTR_LIST(inode_goal),
 	ATTR_LIST(mb_stats),
@@ -670,6 +670,7 @@ static long wb_writeback(struct bdi_writeback *wb,
 	long wrote = 0;
 	long write_chunk = MAX_WRITEBACK_PAGES;
 	struct inode *inode;
+	struct blk_plug plug;
 
 	if (wbc.for_kupdate) {
 		wbc.older_than_this = &oldest_jif;
@@ -697,6 +698,13 @@ static long wb_writeback(struct bdi_writeback *wb,
 	if (wbc.sync_mode == WB_SYNC_ALL || wbc.tagged_writepages)
 		write_chunk = LONG_MAX;
 
+	/*
+	 * Plug across inodes, so that small files laid out next to each
+	 * other by the allocator go down as a few large requests instead
+	 * of one request per file.
+	 */
+	blk_start_plug(&plug);
+
 	wbc.wb_start = jiffies; /* livelock avoidance */
 	for (;;) {
 		/*
@@ -766,6 +774,7 @@ static long wb_writeback(struct bdi_writeback *wb,
 		}
 		spin_unlock(&inode_wb_list_lock);
 	}
+	blk_finish_plug(&plug);
 
 	return wrote;
 }
@@ -601,6 +601,167 @@ const struct file_operations proc_clear_refs_operations = {
 	.llseek		= noop_llseek,
 };
 
+#ifdef CONFIG_PROCESS_RECLAIM
+enum reclaim_type {
+	RECLAIM_FILE,
+	RECLAIM_ANON,
+	RECLAIM_ALL,
+};
+
+struct reclaim_walk {
+	struct vm_area_struct *vma;
+	enum reclaim_type type;
+	unsigned long nr_scanned;
+	unsigned long nr_reclaimed;
+};
+
+static int reclaim_pte_range(pmd_t *pmd, unsigned long addr,
+			     unsigned long end, struct mm_walk *walk)
+{
+	struct reclaim_walk *rw = walk->private;
+	struct vm_area_struct *vma = rw->vma;
+	pte_t *pte, ptent;
+	spinlock_t *ptl;
+	struct page *page;
+	LIST_HEAD(page_list);
+	int isolated;
+	int file;
+
+	split_huge_page_pmd(walk->mm, pmd);
+	if (pmd_trans_unstable(pmd))
+		return 0;
+cont:
+	isolated = 0;
+	pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		ptent = *pte;
+		if (!pte_present(ptent))
+			continue;
+
+		page = vm_normal_page(vma, addr, ptent);
+		if (!page || PageReserved(page))
+			continue;
+
+		/* as page_is_file_cache() */
+		file = !PageSwapBacked(page);
+		if (rw->type == RECLAIM_FILE && !file)
+			continue;
+		if (rw->type == RECLAIM_ANON && file)
+			continue;
+
+		/* Leave pages other processes are using to global reclaim */
+		if (page_mapcount(page) != 1)
+			continue;
+
+		if (isolate_lru_page(page))
+			continue;
+
+		list_add(&page->lru, &page_list);
+		inc_zone_page_state(page, NR_ISOLATED_ANON + file);
+		if (++isolated >= SWAP_CLUSTER_MAX) {
+			pte++;
+			addr += PAGE_SIZE;
+			break;
+		}
+	}
+	pte_unmap_unlock(pte - 1, ptl);
+
+	rw->nr_scanned += isolated;
+	rw->nr_reclaimed += reclaim_pages_from_list(&page_list);
+	cond_resched();
+	if (addr != end)
+		goto cont;
+
+	return 0;
+}
+
+static ssize_t reclaim_write(struct file *file, const char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	struct task_struct *task;
+	char buffer[PROC_NUMBUF];
+	struct mm_struct *mm;
+	struct vm_area_struct *vma;
+	struct reclaim_walk rw = { };
+	struct mm_walk reclaim_walk = {
+		.pmd_entry = reclaim_pte_range,
+		.private = &rw,
+	};
+	char *type;
+
+	memset(buffer, 0, sizeof(buffer));
+	if (count > sizeof(buffer) - 1)
+		count = sizeof(buffer) - 1;
+	if (copy_from_user(buffer, buf, count))
+		return -EFAULT;
+	type = strstrip(buffer);
+	if (!strcmp(type, "file"))
+		rw.type = RECLAIM_FILE;
+	else if (!strcmp(type, "anon"))
+		rw.type = RECLAIM_ANON;
+	else if (!strcmp(type, "all"))
+		rw.type = RECLAIM_ALL;
+	else
+		return -EINVAL;
+
+	task = get_proc_task(file->f_path.dentry->d_inode);
+	if (!task)
+		return -ESRCH;
+	mm = get_task_mm(task);
+	if (mm) {
+		reclaim_walk.mm = mm;
+		down_read(&mm->mmap_sem);
+		for (vma = mm->mmap; vma; vma = vma->vm_next) {
+			if (is_vm_hugetlb_page(vma))
+				continue;
+			if (vma->vm_flags & VM_LOCKED)
+				continue;
+			rw.vma = vma;
+			walk_page_range(vma->vm_start, vma->vm_end,
+					&reclaim_walk);
+			if (fatal_signal_pending(current))
+				break;
+		}
+		mm->reclaim_scanned += rw.nr_scanned;
+		mm->reclaim_reclaimed += rw.nr_reclaimed;
+		up_read(&mm->mmap_sem);
+		mmput(mm);
+	}
+	put_task_struct(task);
+
+	return count;
+}
+
+static ssize_t reclaim_read(struct file *file, char __user *buf,
+			    size_t count, loff_t *ppos)
+{
+	struct task_struct *task;
+	struct mm_struct *mm;
+	char buffer[64];
+	size_t len = 0;
+
+	task = get_proc_task(file->f_path.dentry->d_inode);
+	if (!task)
+		return -ESRCH;
+	mm = get_task_mm(task);
+	if (mm) {
+		len = snprintf(buffer, sizeof(buffer),
+			       "scanned %lu\nreclaimed %lu\n",
+			       mm->reclaim_scanned, mm->reclaim_reclaimed);
+		mmput(mm);
+	}
+	put_task_struct(task);
+
+	return simple_read_from_buffer(buf, count, ppos, buffer, len);
+}
+
+const struct file_operations proc_reclaim_operations = {
+	.read		= reclaim_read,
+	.write		= reclaim_write,
+	.llseek		= generic_file_llseek,
+};
+#endif /* CONFIG_PROCESS_RECLAIM */
+
 struct pagemapread {
 	int pos, len;
 	u64 *buffer;
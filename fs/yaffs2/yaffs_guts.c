@@ -1394,73 +1394,99 @@ static int yaffs_change_obj_name(struct yaffs_obj *obj,
  *   In Linux, the page cache provides read buffering and the short op cache 
  *   provides write buffering.
  *
- *   There are a limited number (~10) of cache chunks per device so that we don't
- *   need a very intelligent search.
+ *   Cache chunks are found through a hash on object and chunk id and are kept
+ *   on an LRU list, so a device can have a few hundred of them. When a dirty
+ *   chunk is pushed out, all the dirty chunks of its object are written in
+ *   chunk order so that the file's data lands in consecutive NAND pages.
  */
 
-static int yaffs_obj_cache_dirty(struct yaffs_obj *obj)
+static inline struct list_head *yaffs_cache_bucket(struct yaffs_dev *dev,
+						   const struct yaffs_obj *obj,
+						   int chunk_id)
 {
-	struct yaffs_dev *dev = obj->my_dev;
-	int i;
-	struct yaffs_cache *cache;
-	int n_caches = obj->my_dev->param.n_caches;
+	return &dev->cache_hash[(obj->obj_id * 31 + chunk_id) &
+				dev->cache_hash_mask];
+}
 
-	for (i = 0; i < n_caches; i++) {
-		cache = &dev->cache[i];
-		if (cache->object == obj && cache->dirty)
-			return 1;
+/* Dirty state is counted per object and per device so that
+ * yaffs_obj_cache_dirty() and yaffs_get_n_free_chunks() need not scan.
+ */
+static void yaffs_set_cache_dirty(struct yaffs_cache *cache)
+{
+	if (!cache->dirty) {
+		cache->dirty = 1;
+		cache->object->n_dirty_caches++;
+		cache->object->my_dev->cache_n_dirty++;
 	}
+}
 
-	return 0;
+static void yaffs_clear_cache_dirty(struct yaffs_cache *cache)
+{
+	if (cache->dirty) {
+		cache->dirty = 0;
+		cache->object->n_dirty_caches--;
+		cache->object->my_dev->cache_n_dirty--;
+	}
+}
+
+/* Detach a cache from its object and put it back on the free list */
+static void yaffs_release_cache(struct yaffs_dev *dev,
+				struct yaffs_cache *cache)
+{
+	yaffs_clear_cache_dirty(cache);
+	list_del_init(&cache->hash_link);
+	list_move(&cache->lru_link, &dev->cache_free);
+	cache->object = NULL;
+}
+
+static int yaffs_obj_cache_dirty(struct yaffs_obj *obj)
+{
+	return obj->n_dirty_caches > 0;
 }
 
 static void yaffs_flush_file_cache(struct yaffs_obj *obj)
 {
 	struct yaffs_dev *dev = obj->my_dev;
-	int lowest = -99;	/* Stop compiler whining. */
-	int i;
+	struct yaffs_cache **list = dev->cache_flush_list;
 	struct yaffs_cache *cache;
-	int chunk_written = 0;
-	int n_caches = obj->my_dev->param.n_caches;
-
-	if (n_caches > 0) {
-		do {
-			cache = NULL;
-
-			/* Find the dirty cache for this object with the lowest chunk id. */
-			for (i = 0; i < n_caches; i++) {
-				if (dev->cache[i].object == obj &&
-				    dev->cache[i].dirty) {
-					if (!cache
-					    || dev->cache[i].chunk_id <
-					    lowest) {
-						cache = &dev->cache[i];
-						lowest = cache->chunk_id;
-					}
-				}
-			}
+	int chunk_written;
+	int n = 0;
+	int i;
 
-			if (cache && !cache->locked) {
-				/* Write it out and free it up */
+	if (dev->param.n_caches < 1 || !obj->n_dirty_caches)
+		return;
 
-				chunk_written =
-				    yaffs_wr_data_obj(cache->object,
-						      cache->chunk_id,
-						      cache->data,
-						      cache->n_bytes, 1);
-				cache->dirty = 0;
-				cache->object = NULL;
-			}
+	/* Gather the object's dirty chunks sorted by chunk id. The LRU list is
+	 * roughly in write order, so the insertion sort has little to do.
+	 */
+	list_for_each_entry(cache, &dev->cache_lru, lru_link) {
+		if (cache->object != obj || !cache->dirty || cache->locked)
+			continue;
+
+		for (i = n; i > 0 && list[i - 1]->chunk_id > cache->chunk_id;
+		     i--)
+			list[i] = list[i - 1];
+		list[i] = cache;
+		n++;
+	}
 
-		} while (cache && chunk_written > 0);
+	dev->cache_flushes++;
 
-		if (cache)
+	/* Write them out. The data stays cached, now clean. */
+	for (i = 0; i < n; i++) {
+		cache = list[i];
+		chunk_written = yaffs_wr_data_obj(obj, cache->chunk_id,
+						  cache->data, cache->n_bytes,
+						  1);
+		if (chunk_written <= 0) {
 			/* Hoosterman, disk full while writing cache out. */
 			yaffs_trace(YAFFS_TRACE_ERROR,
 				"yaffs tragedy: no space during cache write");
-
+			break;
+		}
+		yaffs_clear_cache_dirty(cache);
+		dev->cache_flushed_chunks++;
 	}
-
 }
 
 /*yaffs_flush_whole_cache(dev)
@@ -1470,96 +1496,85 @@ static void yaffs_flush_file_cache(struct yaffs_obj *obj)
 
 void yaffs_flush_whole_cache(struct yaffs_dev *dev)
 {
-	struct yaffs_obj *obj;
-	int n_caches = dev->param.n_caches;
+	struct yaffs_cache *cache;
 	int i;
 
-	/* Find a dirty object in the cache and flush it...
-	 * until there are no further dirty objects.
+	/* Flush every object that has dirty chunks. A failed flush leaves
+	 * chunks dirty, so visit each cache only once rather than looping
+	 * until everything is clean.
 	 */
-	do {
-		obj = NULL;
-		for (i = 0; i < n_caches && !obj; i++) {
-			if (dev->cache[i].object && dev->cache[i].dirty)
-				obj = dev->cache[i].object;
-
-		}
-		if (obj)
-			yaffs_flush_file_cache(obj);
-
-	} while (obj);
-
+	for (i = 0; i < dev->param.n_caches && dev->cache_n_dirty > 0; i++) {
+		cache = &dev->cache[i];
+		if (cache->object && cache->dirty)
+			yaffs_flush_file_cache(cache->object);
+	}
 }
 
-/* Grab us a cache chunk for use.
- * First look for an empty one.
- * Then look for the least recently used non-dirty one.
- * Then look for the least recently used dirty one...., flush and look again.
+/* Grab us a cache chunk for obj/chunk_id and hash it in.
+ * Take a free one if there is one, else push out the least recently used
+ * one, flushing its object first if it is dirty.
+ * Returns NULL if caching is off or the flush failed.
  */
-static struct yaffs_cache *yaffs_grab_chunk_worker(struct yaffs_dev *dev)
+static struct yaffs_cache *yaffs_grab_chunk_cache(struct yaffs_obj *obj,
+						  int chunk_id)
 {
-	int i;
+	struct yaffs_dev *dev = obj->my_dev;
+	struct yaffs_cache *cache = NULL;
+	struct yaffs_cache *victim;
 
-	if (dev->param.n_caches > 0) {
-		for (i = 0; i < dev->param.n_caches; i++) {
-			if (!dev->cache[i].object)
-				return &dev->cache[i];
+	if (dev->param.n_caches < 1)
+		return NULL;
+
+	if (!list_empty(&dev->cache_free)) {
+		cache = list_entry(dev->cache_free.next, struct yaffs_cache,
+				   lru_link);
+	} else {
+		/* With locking we can't assume the head is usable */
+		list_for_each_entry(victim, &dev->cache_lru, lru_link) {
+			if (!victim->locked) {
+				cache = victim;
+				break;
+			}
 		}
+		if (!cache)
+			return NULL;
+
+		if (cache->dirty)
+			yaffs_flush_file_cache(cache->object);
+		if (cache->dirty)
+			return NULL;
+
+		list_del_init(&cache->hash_link);
+		dev->cache_evictions++;
 	}
 
-	return NULL;
+	cache->object = obj;
+	cache->chunk_id = chunk_id;
+	cache->dirty = 0;
+	cache->locked = 0;
+	cache->n_bytes = 0;
+	list_add(&cache->hash_link, yaffs_cache_bucket(dev, obj, chunk_id));
+	list_move_tail(&cache->lru_link, &dev->cache_lru);
+
+	return cache;
 }
 
-static struct yaffs_cache *yaffs_grab_chunk_cache(struct yaffs_dev *dev)
+/* Look up a cached chunk without touching the statistics */
+static struct yaffs_cache *yaffs_lookup_chunk_cache(const struct yaffs_obj *obj,
+						    int chunk_id)
 {
+	struct yaffs_dev *dev = obj->my_dev;
 	struct yaffs_cache *cache;
-	struct yaffs_obj *the_obj;
-	int usage;
-	int i;
-	int pushout;
-
-	if (dev->param.n_caches > 0) {
-		/* Try find a non-dirty one... */
-
-		cache = yaffs_grab_chunk_worker(dev);
 
-		if (!cache) {
-			/* They were all dirty, find the last recently used object and flush
-			 * its cache, then  find again.
-			 * NB what's here is not very accurate, we actually flush the object
-			 * the last recently used page.
-			 */
-
-			/* With locking we can't assume we can use entry zero */
-
-			the_obj = NULL;
-			usage = -1;
-			cache = NULL;
-			pushout = -1;
-
-			for (i = 0; i < dev->param.n_caches; i++) {
-				if (dev->cache[i].object &&
-				    !dev->cache[i].locked &&
-				    (dev->cache[i].last_use < usage
-				     || !cache)) {
-					usage = dev->cache[i].last_use;
-					the_obj = dev->cache[i].object;
-					cache = &dev->cache[i];
-					pushout = i;
-				}
-			}
-
-			if (!cache || cache->dirty) {
-				/* Flush and try again */
-				yaffs_flush_file_cache(the_obj);
-				cache = yaffs_grab_chunk_worker(dev);
-			}
-
-		}
-		return cache;
-	} else {
+	if (dev->param.n_caches < 1)
 		return NULL;
-        }
+
+	list_for_each_entry(cache, yaffs_cache_bucket(dev, obj, chunk_id),
+			    hash_link) {
+		if (cache->object == obj && cache->chunk_id == chunk_id)
+			return cache;
+	}
+	return NULL;
 }
 
 /* Find a cached chunk */
@@ -1567,42 +1582,27 @@ static struct yaffs_cache *yaffs_find_chunk_cache(const struct yaffs_obj *obj,
 						  int chunk_id)
 {
 	struct yaffs_dev *dev = obj->my_dev;
-	int i;
-	if (dev->param.n_caches > 0) {
-		for (i = 0; i < dev->param.n_caches; i++) {
-			if (dev->cache[i].object == obj &&
-			    dev->cache[i].chunk_id == chunk_id) {
-				dev->cache_hits++;
+	struct yaffs_cache *cache;
 
-				return &dev->cache[i];
-			}
-		}
-	}
-	return NULL;
+	if (dev->param.n_caches < 1)
+		return NULL;
+
+	dev->cache_lookups++;
+	cache = yaffs_lookup_chunk_cache(obj, chunk_id);
+	if (cache)
+		dev->cache_hits++;
+
+	return cache;
 }
 
 /* Mark the chunk for the least recently used algorithym */
 static void yaffs_use_cache(struct yaffs_dev *dev, struct yaffs_cache *cache,
 			    int is_write)
 {
+	list_move_tail(&cache->lru_link, &dev->cache_lru);
 
-	if (dev->param.n_caches > 0) {
-		if (dev->cache_last_use < 0 || dev->cache_last_use > 100000000) {
-			/* Reset the cache usages */
-			int i;
-			for (i = 1; i < dev->param.n_caches; i++)
-				dev->cache[i].last_use = 0;
-
-			dev->cache_last_use = 0;
-		}
-
-		dev->cache_last_use++;
-
-		cache->last_use = dev->cache_last_use;
-
-		if (is_write)
-			cache->dirty = 1;
-	}
+	if (is_write)
+		yaffs_set_cache_dirty(cache);
 }
 
 /* Invalidate a single cache page.
@@ -1611,13 +1611,10 @@ static void yaffs_use_cache(struct yaffs_dev *dev, struct yaffs_cache *cache,
  */
 static void yaffs_invalidate_chunk_cache(struct yaffs_obj *object, int chunk_id)
 {
-	if (object->my_dev->param.n_caches > 0) {
-		struct yaffs_cache *cache =
-		    yaffs_find_chunk_cache(object, chunk_id);
+	struct yaffs_cache *cache = yaffs_lookup_chunk_cache(object, chunk_id);
 
-		if (cache)
-			cache->object = NULL;
-	}
+	if (cache)
+		yaffs_release_cache(object->my_dev, cache);
 }
 
 /* Invalidate all the cache pages associated with this object
@@ -1628,12 +1625,9 @@ static void yaffs_invalidate_whole_cache(struct yaffs_obj *in)
 	int i;
 	struct yaffs_dev *dev = in->my_dev;
 
-	if (dev->param.n_caches > 0) {
-		/* Invalidate it. */
-		for (i = 0; i < dev->param.n_caches; i++) {
-			if (dev->cache[i].object == in)
-				dev->cache[i].object = NULL;
-		}
+	for (i = 0; i < dev->param.n_caches; i++) {
+		if (dev->cache[i].object == in)
+			yaffs_release_cache(dev, &dev->cache[i]);
 	}
 }
 
@@ -2891,6 +2885,10 @@ static int yaffs_check_gc(struct yaffs_dev *dev, int background)
 	int min_erased;
 	int erased_chunks;
 	int checkpt_block_adjust;
+	u32 copies = dev->n_gc_copies;
+	int timed = 0;
+	s64 start = 0;
+	u32 stall;
 
 	if (dev->param.gc_control && (dev->param.gc_control(dev) & 1) == 0)
 		return YAFFS_OK;
@@ -2958,6 +2956,12 @@ static int yaffs_check_gc(struct yaffs_dev *dev, int background)
 				"yaffs: GC n_erased_blocks %d aggressive %d",
 				dev->n_erased_blocks, aggressive);
 
+			/* Time the collections that hold up a writer */
+			if (!background && !timed) {
+				start = Y_CLOCK_US();
+				timed = 1;
+			}
+
 			gc_ok = yaffs_gc_block(dev, dev->gc_block, aggressive);
 		}
 
@@ -2971,6 +2975,16 @@ static int yaffs_check_gc(struct yaffs_dev *dev, int background)
 	} while ((dev->n_erased_blocks < dev->param.n_reserved_blocks) &&
 		 (dev->gc_block > 0) && (max_tries < 2));
 
+	if (background) {
+		dev->n_bg_gc_copies += dev->n_gc_copies - copies;
+	} else if (timed) {
+		stall = Y_CLOCK_US() - start;
+		dev->n_fg_gcs++;
+		dev->fg_gc_stall_us += stall;
+		if (stall > dev->fg_gc_max_stall_us)
+			dev->fg_gc_max_stall_us = stall;
+	}
+
 	return aggressive ? gc_ok : YAFFS_OK;
 }
 
@@ -3574,22 +3588,17 @@ int yaffs_file_rd(struct yaffs_obj *in, u8 * buffer, loff_t offset, int n_bytes)
 		 */
 		if (cache || n_copy != dev->data_bytes_per_chunk
 		    || dev->param.inband_tags) {
-			if (dev->param.n_caches > 0) {
 
-				/* If we can't find the data in the cache, then load it up. */
+			/* If we can't find the data in the cache, then load it up. */
 
-				if (!cache) {
-					cache =
-					    yaffs_grab_chunk_cache(in->my_dev);
-					cache->object = in;
-					cache->chunk_id = chunk;
-					cache->dirty = 0;
-					cache->locked = 0;
+			if (!cache) {
+				cache = yaffs_grab_chunk_cache(in, chunk);
+				if (cache)
 					yaffs_rd_data_obj(in, chunk,
 							  cache->data);
-					cache->n_bytes = 0;
-				}
+			}
 
+			if (cache) {
 				yaffs_use_cache(dev, cache, 0);
 
 				cache->locked = 1;
@@ -3627,6 +3636,115 @@ int yaffs_file_rd(struct yaffs_obj *in, u8 * buffer, loff_t offset, int n_bytes)
 	return n_done;
 }
 
+/*
+ * Reads a chunk of a file for yaffs_file_rd_shared().  Returns -1 if the
+ * read hit an ECC error, which must be handled under the exclusive lock.
+ */
+static int yaffs_rd_data_obj_shared(struct yaffs_obj *in, int inode_chunk,
+				    u8 * buffer,
+				    struct yaffs_shared_rd_stats *stats)
+{
+	struct yaffs_ext_tags tags;
+	int nand_chunk = yaffs_find_chunk_in_file(in, inode_chunk, NULL);
+
+	if (nand_chunk < 0) {
+		/* get sane (zero) data if you read a hole */
+		memset(buffer, 0, in->my_dev->data_bytes_per_chunk);
+		return 0;
+	}
+
+	stats->page_reads++;
+	yaffs_rd_chunk_tags_nand_shared(in->my_dev, nand_chunk, buffer, &tags);
+	if (tags.ecc_result > YAFFS_ECC_RESULT_NO_ERROR)
+		return -1;
+	return 0;
+}
+
+/*
+ * yaffs_file_rd_shared() reads like yaffs_file_rd(), but without changing
+ * the device state, so that several readers may run at once as long as
+ * writers are kept out.  Chunks held in the short-op cache are copied from
+ * there without touching the LRU; anything else is read from NAND, a
+ * partial chunk through a private buffer rather than a temp buffer.  The
+ * statistics are gathered in @stats, for the caller to add to the device
+ * under a lock of its own.
+ *
+ * The yaffs1 and inband tags read paths use shared scratch buffers, and
+ * finding a chunk in a chunk group reads tags with error handling, so
+ * those devices return -1 and the caller must use yaffs_file_rd().  -1 is
+ * also returned if memory is short or a chunk read hit an ECC error; the
+ * buffer may then have been partly filled.
+ */
+int yaffs_file_rd_shared(struct yaffs_obj *in, u8 * buffer, loff_t offset,
+			 int n_bytes, struct yaffs_shared_rd_stats *stats)
+{
+	int chunk;
+	u32 start;
+	int n_copy;
+	int n = n_bytes;
+	int n_done = 0;
+	struct yaffs_cache *cache;
+	u8 *local_buffer = NULL;
+
+	struct yaffs_dev *dev;
+
+	dev = in->my_dev;
+
+	if (!dev->param.is_yaffs2 || dev->param.inband_tags ||
+	    dev->chunk_grp_size > 1)
+		return -1;
+
+	while (n > 0) {
+		yaffs_addr_to_chunk(dev, offset, &chunk, &start);
+		chunk++;
+
+		if ((start + n) < dev->data_bytes_per_chunk)
+			n_copy = n;
+		else
+			n_copy = dev->data_bytes_per_chunk - start;
+
+		cache = NULL;
+		if (dev->param.n_caches > 0) {
+			stats->cache_lookups++;
+			cache = yaffs_lookup_chunk_cache(in, chunk);
+			if (cache)
+				stats->cache_hits++;
+		}
+
+		if (cache) {
+			memcpy(buffer, &cache->data[start], n_copy);
+		} else if (n_copy == dev->data_bytes_per_chunk) {
+			/* A full chunk. Read directly into the supplied buffer. */
+			if (yaffs_rd_data_obj_shared(in, chunk, buffer, stats))
+				goto fail;
+		} else {
+			if (!local_buffer) {
+				local_buffer = kmalloc(dev->data_bytes_per_chunk,
+						       GFP_NOFS);
+				if (!local_buffer)
+					return -1;
+			}
+			if (yaffs_rd_data_obj_shared(in, chunk, local_buffer,
+						     stats))
+				goto fail;
+			memcpy(buffer, &local_buffer[start], n_copy);
+		}
+
+		n -= n_copy;
+		offset += n_copy;
+		buffer += n_copy;
+		n_done += n_copy;
+	}
+
+	kfree(local_buffer);
+
+	return n_done;
+
+fail:
+	kfree(local_buffer);
+	return -1;
+}
+
 int yaffs_do_file_wr(struct yaffs_obj *in, const u8 * buffer, loff_t offset,
 		     int n_bytes, int write_trhrough)
 {
@@ -3706,13 +3824,11 @@ int yaffs_do_file_wr(struct yaffs_obj *in, const u8 * buffer, loff_t offset,
 
 				if (!cache
 				    && yaffs_check_alloc_available(dev, 1)) {
-					cache = yaffs_grab_chunk_cache(dev);
-					cache->object = in;
-					cache->chunk_id = chunk;
-					cache->dirty = 0;
-					cache->locked = 0;
-					yaffs_rd_data_obj(in, chunk,
-							  cache->data);
+					cache = yaffs_grab_chunk_cache(in,
+								       chunk);
+					if (cache)
+						yaffs_rd_data_obj(in, chunk,
+								  cache->data);
 				} else if (cache &&
 					   !cache->dirty &&
 					   !yaffs_check_alloc_available(dev,
@@ -3740,7 +3856,7 @@ int yaffs_do_file_wr(struct yaffs_obj *in, const u8 * buffer, loff_t offset,
 						     cache->chunk_id,
 						     cache->data,
 						     cache->n_bytes, 1);
-						cache->dirty = 0;
+						yaffs_clear_cache_dirty(cache);
 					}
 
 				} else {
@@ -4764,6 +4880,8 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 	int init_failed = 0;
 	unsigned x;
 	int bits;
+	s64 mount_start = Y_CLOCK_US();
+	s64 t;
 
 	yaffs_trace(YAFFS_TRACE_TRACING, "yaffs: yaffs_guts_initialise()" );
 
@@ -4916,6 +5034,10 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 	dev->passive_gc_count = 0;
 	dev->oldest_dirty_gc_count = 0;
 	dev->bg_gcs = 0;
+	dev->n_bg_gc_copies = 0;
+	dev->n_fg_gcs = 0;
+	dev->fg_gc_stall_us = 0;
+	dev->fg_gc_max_stall_us = 0;
 	dev->gc_block_finder = 0;
 	dev->buffered_block = -1;
 	dev->doing_buffered_block_rewrite = 0;
@@ -4939,38 +5061,65 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 		init_failed = 1;
 
 	dev->cache = NULL;
+	dev->cache_hash = NULL;
+	dev->cache_flush_list = NULL;
+	dev->cache_n_dirty = 0;
+	INIT_LIST_HEAD(&dev->cache_lru);
+	INIT_LIST_HEAD(&dev->cache_free);
 	dev->gc_cleanup_list = NULL;
 
 	if (!init_failed && dev->param.n_caches > 0) {
 		int i;
 		void *buf;
-		int cache_bytes =
-		    dev->param.n_caches * sizeof(struct yaffs_cache);
+		int cache_bytes;
+		u32 n_buckets = 1;
 
 		if (dev->param.n_caches > YAFFS_MAX_SHORT_OP_CACHES)
 			dev->param.n_caches = YAFFS_MAX_SHORT_OP_CACHES;
 
+		cache_bytes = dev->param.n_caches * sizeof(struct yaffs_cache);
+		while (n_buckets < dev->param.n_caches)
+			n_buckets <<= 1;
+
 		dev->cache = kmalloc(cache_bytes, GFP_NOFS);
+		dev->cache_hash =
+		    kmalloc(n_buckets * sizeof(struct list_head), GFP_NOFS);
+		dev->cache_flush_list =
+		    kmalloc(dev->param.n_caches * sizeof(struct yaffs_cache *),
+			    GFP_NOFS);
 
 		buf = (u8 *) dev->cache;
 
 		if (dev->cache)
 			memset(dev->cache, 0, cache_bytes);
 
+		if (!dev->cache_hash || !dev->cache_flush_list)
+			buf = NULL;
+
+		if (buf) {
+			dev->cache_hash_mask = n_buckets - 1;
+			for (i = 0; i < n_buckets; i++)
+				INIT_LIST_HEAD(&dev->cache_hash[i]);
+		}
+
 		for (i = 0; i < dev->param.n_caches && buf; i++) {
+			INIT_LIST_HEAD(&dev->cache[i].hash_link);
+			list_add_tail(&dev->cache[i].lru_link,
+				      &dev->cache_free);
 			dev->cache[i].object = NULL;
-			dev->cache[i].last_use = 0;
 			dev->cache[i].dirty = 0;
 			dev->cache[i].data = buf =
 			    kmalloc(dev->param.total_bytes_per_chunk, GFP_NOFS);
 		}
 		if (!buf)
 			init_failed = 1;
-
-		dev->cache_last_use = 0;
 	}
 
 	dev->cache_hits = 0;
+	dev->cache_lookups = 0;
+	dev->cache_evictions = 0;
+	dev->cache_flushes = 0;
+	dev->cache_flushed_chunks = 0;
 
 	if (!init_failed) {
 		dev->gc_cleanup_list =
@@ -4991,10 +5140,25 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 	if (!init_failed && !yaffs_create_initial_dir(dev))
 		init_failed = 1;
 
+	dev->mount_from_checkpt = 0;
+	dev->mount_checkpt_us = 0;
+	dev->mount_scan_state_us = 0;
+	dev->mount_scan_us = 0;
+	dev->mount_scan_blocks = 0;
+	dev->mount_scan_chunks = 0;
+	dev->checkpt_saves = 0;
+	dev->checkpt_save_us = 0;
+	dev->checkpt_save_max_us = 0;
+	dev->checkpt_save_bytes = 0;
+
 	if (!init_failed) {
 		/* Now scan the flash. */
 		if (dev->param.is_yaffs2) {
-			if (yaffs2_checkpt_restore(dev)) {
+			t = Y_CLOCK_US();
+			dev->mount_from_checkpt = yaffs2_checkpt_restore(dev);
+			dev->mount_checkpt_us = Y_CLOCK_US() - t;
+
+			if (dev->mount_from_checkpt) {
 				yaffs_check_obj_details_loaded(dev->root_dir);
 				yaffs_trace(YAFFS_TRACE_CHECKPOINT | YAFFS_TRACE_MOUNT,
 					"yaffs: restored from checkpoint"
@@ -5025,17 +5189,24 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 				    && !yaffs_create_initial_dir(dev))
 					init_failed = 1;
 
+				t = Y_CLOCK_US();
 				if (!init_failed && !yaffs2_scan_backwards(dev))
 					init_failed = 1;
+				dev->mount_scan_us = Y_CLOCK_US() - t;
 			}
-		} else if (!yaffs1_scan(dev)) {
-			init_failed = 1;
-                }
+		} else {
+			t = Y_CLOCK_US();
+			if (!yaffs1_scan(dev))
+				init_failed = 1;
+			dev->mount_scan_us = Y_CLOCK_US() - t;
+		}
 
+		t = Y_CLOCK_US();
 		yaffs_strip_deleted_objs(dev);
 		yaffs_fix_hanging_objs(dev);
 		if (dev->param.empty_lost_n_found)
 			yaffs_empty_l_n_f(dev);
+		dev->mount_fixup_us = Y_CLOCK_US() - t;
 	}
 
 	if (init_failed) {
@@ -5047,6 +5218,16 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 		return YAFFS_FAIL;
 	}
 
+	dev->mount_page_reads = dev->n_page_reads;
+	dev->mount_total_us = Y_CLOCK_US() - mount_start;
+
+	yaffs_trace(YAFFS_TRACE_MOUNT,
+		"yaffs: mounted from %s in %u us: checkpoint %u scan %u fixup %u, %u page reads",
+		dev->mount_from_checkpt ? "checkpoint" : "scan",
+		dev->mount_total_us, dev->mount_checkpt_us,
+		dev->mount_scan_us, dev->mount_fixup_us,
+		dev->mount_page_reads);
+
 	/* Zero out stats */
 	dev->n_page_reads = 0;
 	dev->n_page_writes = 0;
@@ -5087,6 +5268,10 @@ void yaffs_deinitialise(struct yaffs_dev *dev)
 			kfree(dev->cache);
 			dev->cache = NULL;
 		}
+		kfree(dev->cache_hash);
+		dev->cache_hash = NULL;
+		kfree(dev->cache_flush_list);
+		dev->cache_flush_list = NULL;
 
 		kfree(dev->gc_cleanup_list);
 
@@ -5132,21 +5317,13 @@ int yaffs_get_n_free_chunks(struct yaffs_dev *dev)
 	/* This is what we report to the outside world */
 
 	int n_free;
-	int n_dirty_caches;
 	int blocks_for_checkpt;
-	int i;
 
 	n_free = dev->n_free_chunks;
 	n_free += dev->n_deleted_files;
 
-	/* Now count the number of dirty chunks in the cache and subtract those */
-
-	for (n_dirty_caches = 0, i = 0; i < dev->param.n_caches; i++) {
-		if (dev->cache[i].dirty)
-			n_dirty_caches++;
-	}
-
-	n_free -= n_dirty_caches;
+	/* Now subtract the number of dirty chunks in the cache */
+	n_free -= dev->cache_n_dirty;
 
 	n_free -=
 	    ((dev->param.n_reserved_blocks + 1) * dev->param.chunks_per_block);
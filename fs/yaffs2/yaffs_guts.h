@@ -83,7 +83,7 @@
 #define YAFFS_OBJECTID_CHECKPOINT_DATA	0x20
 #define YAFFS_SEQUENCE_CHECKPOINT_DATA  0x21
 
-#define YAFFS_MAX_SHORT_OP_CACHES	20
+#define YAFFS_MAX_SHORT_OP_CACHES	256
 
 #define YAFFS_N_TEMP_BUFFERS		6
 
@@ -108,9 +108,10 @@
 
 /* ChunkCache is used for short read/write operations.*/
 struct yaffs_cache {
+	struct list_head hash_link;	/* list of caches in this hash bucket */
+	struct list_head lru_link;	/* position in the LRU or the free list */
 	struct yaffs_obj *object;
 	int chunk_id;
-	int last_use;
 	int dirty;
 	int n_bytes;		/* Only valid if the cache is dirty */
 	int locked;		/* Can't push out or flush while locked. */
@@ -401,6 +402,7 @@ struct yaffs_obj {
 
 	u8 serial;		/* serial number of chunk in NAND. Cached here */
 	u16 sum;		/* sum of the name to speed searching */
+	u16 n_dirty_caches;	/* number of dirty short op caches held */
 
 	struct yaffs_dev *my_dev;	/* The device I'm on */
 
@@ -506,8 +508,8 @@ struct yaffs_param {
 	/* reserved blocks on NOR and RAM. */
 
 	int n_caches;		/* If <= 0, then short op caching is disabled, else
-				 * the number of short op caches (don't use too many).
-				 * 10 to 20 is a good bet.
+				 * the number of short op caches. Lookups are hashed
+				 * so up to YAFFS_MAX_SHORT_OP_CACHES is fine.
 				 */
 	int use_nand_ecc;	/* Flag to decide whether or not to use NANDECC on data (yaffs1) */
 	int no_tags_ecc;	/* Flag to decide whether or not to do ECC on packed tags (yaffs2) */
@@ -684,8 +686,14 @@ struct yaffs_dev {
 	int buffered_block;	/* Which block is buffered here? */
 	int doing_buffered_block_rewrite;
 
+	/* Short op cache */
 	struct yaffs_cache *cache;
-	int cache_last_use;
+	struct list_head *cache_hash;	/* buckets keyed by object and chunk */
+	u32 cache_hash_mask;
+	struct list_head cache_lru;	/* in-use caches, least recently used first */
+	struct list_head cache_free;	/* unused caches */
+	struct yaffs_cache **cache_flush_list;	/* scratch for sorting flushes */
+	int cache_n_dirty;
 
 	/* Stuff for background deletion and unlinked files. */
 	struct yaffs_obj *unlinked_dir;	/* Directory where unlinked and deleted files live. */
@@ -724,6 +732,27 @@ struct yaffs_dev {
 	u32 oldest_dirty_gc_count;
 	u32 n_gc_blocks;
 	u32 bg_gcs;
+	u32 n_bg_gc_copies;	/* chunks copied by background gc */
+	u32 n_fg_gcs;		/* gc passes that stalled a writer */
+	u64 fg_gc_stall_us;
+	u32 fg_gc_max_stall_us;
+
+	/* Mount time breakdown, times in microseconds */
+	int mount_from_checkpt;	/* the checkpoint was usable */
+	u32 mount_checkpt_us;	/* reading the checkpoint */
+	u32 mount_scan_state_us;	/* reading block states (yaffs2: and sorting) */
+	u32 mount_scan_us;	/* the whole scan, including the above */
+	u32 mount_fixup_us;	/* tidying up after the checkpoint or scan */
+	u32 mount_total_us;
+	u32 mount_scan_blocks;	/* blocks whose chunks were scanned */
+	u32 mount_scan_chunks;	/* chunk tags read by the scan */
+	u32 mount_page_reads;
+
+	/* Checkpoint writes */
+	u32 checkpt_saves;
+	u64 checkpt_save_us;
+	u32 checkpt_save_max_us;
+	u32 checkpt_save_bytes;	/* size of the last checkpoint written */
 	u32 n_retired_writes;
 	u32 n_retired_blocks;
 	u32 n_ecc_fixed;
@@ -734,6 +763,10 @@ struct yaffs_dev {
 	u32 n_unmarked_deletions;
 	u32 refresh_count;
 	u32 cache_hits;
+	u32 cache_lookups;
+	u32 cache_evictions;
+	u32 cache_flushes;
+	u32 cache_flushed_chunks;
 
 };
 
@@ -798,9 +831,18 @@ int yaffs_get_obj_inode(struct yaffs_obj *obj);
 unsigned yaffs_get_obj_type(struct yaffs_obj *obj);
 int yaffs_get_obj_link_count(struct yaffs_obj *obj);
 
+/* Device statistics gathered by yaffs_file_rd_shared() */
+struct yaffs_shared_rd_stats {
+	u32 page_reads;
+	u32 cache_lookups;
+	u32 cache_hits;
+};
+
 /* File operations */
 int yaffs_file_rd(struct yaffs_obj *obj, u8 * buffer, loff_t offset,
 		  int n_bytes);
+int yaffs_file_rd_shared(struct yaffs_obj *obj, u8 * buffer, loff_t offset,
+			 int n_bytes, struct yaffs_shared_rd_stats *stats);
 int yaffs_wr_file(struct yaffs_obj *obj, const u8 * buffer, loff_t offset,
 		  int n_bytes, int write_trhrough);
 int yaffs_resize_file(struct yaffs_obj *obj, loff_t new_size);
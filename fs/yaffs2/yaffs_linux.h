@@ -18,16 +18,55 @@
 
 #include "yportenv.h"
 
+#include <linux/atomic.h>
+#include <linux/ktime.h>
+#include <linux/rwsem.h>
+
+/* Gross lock statistics, times in microseconds; under stats_lock */
+struct yaffs_lock_stats {
+	/* Exclusive holders */
+	unsigned long acquired;
+	unsigned long contended;
+	u64 wait_us;
+	u64 hold_us;
+	unsigned long max_hold_us;
+
+	/* Shared holders */
+	unsigned long shared_acquired;
+	unsigned long shared_contended;
+	u64 shared_wait_us;
+};
+
+/* Background gc thread statistics, updated by the thread only */
+struct yaffs_bg_stats {
+	unsigned long passes;	/* yaffs_bg_gc() calls */
+	unsigned long deferred;	/* wakeups that skipped gc for foreground I/O */
+	unsigned long yields;	/* batches cut short by a waiting locker */
+};
+
 struct yaffs_linux_context {
 	struct list_head context_list;	/* List of these we have mounted */
 	struct yaffs_dev *dev;
 	struct super_block *super;
 	struct task_struct *bg_thread;	/* Background thread for this device */
 	int bg_running;
-	struct mutex gross_lock;	/* Gross locking mutex*/
+	unsigned long fg_last_active;	/* jiffies of last foreground lock */
+	atomic_t fg_waiters;	/* foreground tasks blocked on gross_lock */
+	struct yaffs_bg_stats bg_stats;
+	/* Gross lock. Held exclusively by everything but the page reads
+	 * done with yaffs_file_rd_shared(), which share it.
+	 */
+	struct rw_semaphore gross_lock;
+	ktime_t gross_lock_taken;	/* When the exclusive holder got it */
+	/* Protects lock_stats, and the device statistics against
+	 * concurrent shared holders of the gross lock.
+	 */
+	spinlock_t stats_lock;
+	struct yaffs_lock_stats lock_stats;
 	u8 *spare_buffer;	/* For mtdif2 use. Don't know the size of the buffer
 				 * at compile time so we have to allocate it.
 				 */
+	struct mutex spare_lock;	/* Serialises spare_buffer users */
 	struct list_head search_contexts;
 	void (*put_super_fn) (struct super_block * sb);
 
@@ -126,7 +126,13 @@ int nandmtd2_read_chunk_tags(struct yaffs_dev *dev, int nand_chunk,
 		ops.ooboffs = 0;
 		ops.datbuf = data;
 		ops.oobbuf = yaffs_dev_to_lc(dev)->spare_buffer;
+		/* Shared readers may get here concurrently */
+		mutex_lock(&yaffs_dev_to_lc(dev)->spare_lock);
 		retval = mtd->read_oob(mtd, addr, &ops);
+		memcpy(packed_tags_ptr,
+		       yaffs_dev_to_lc(dev)->spare_buffer,
+		       packed_tags_size);
+		mutex_unlock(&yaffs_dev_to_lc(dev)->spare_lock);
 	}
 
 	if (dev->param.inband_tags) {
@@ -138,26 +144,27 @@ int nandmtd2_read_chunk_tags(struct yaffs_dev *dev, int nand_chunk,
 			yaffs_unpack_tags2_tags_only(tags, pt2tp);
 		}
 	} else {
-		if (tags) {
-			memcpy(packed_tags_ptr,
-			       yaffs_dev_to_lc(dev)->spare_buffer,
-			       packed_tags_size);
+		if (tags)
 			yaffs_unpack_tags2(tags, &pt, !dev->param.no_tags_ecc);
-		}
 	}
 
 	if (local_data)
 		yaffs_release_temp_buffer(dev, data, __LINE__);
 
+	/* stats_lock, as shared readers may get here concurrently */
 	if (tags && retval == -EBADMSG
 	    && tags->ecc_result == YAFFS_ECC_RESULT_NO_ERROR) {
 		tags->ecc_result = YAFFS_ECC_RESULT_UNFIXED;
+		spin_lock(&yaffs_dev_to_lc(dev)->stats_lock);
 		dev->n_ecc_unfixed++;
+		spin_unlock(&yaffs_dev_to_lc(dev)->stats_lock);
 	}
 	if (tags && retval == -EUCLEAN
 	    && tags->ecc_result == YAFFS_ECC_RESULT_NO_ERROR) {
 		tags->ecc_result = YAFFS_ECC_RESULT_FIXED;
+		spin_lock(&yaffs_dev_to_lc(dev)->stats_lock);
 		dev->n_ecc_fixed++;
+		spin_unlock(&yaffs_dev_to_lc(dev)->stats_lock);
 	}
 	if (retval == 0)
 		return YAFFS_OK;
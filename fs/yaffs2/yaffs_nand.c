@@ -50,6 +50,24 @@ int yaffs_rd_chunk_tags_nand(struct yaffs_dev *dev, int nand_chunk,
 	return result;
 }
 
+/*
+ * Like yaffs_rd_chunk_tags_nand(), but touches neither the statistics nor
+ * the block state, so that it can run under the shared gross lock.  An ECC
+ * error is only reported in tags->ecc_result: the caller must then read
+ * the chunk again with yaffs_rd_chunk_tags_nand() under the exclusive
+ * lock, which handles it.
+ */
+int yaffs_rd_chunk_tags_nand_shared(struct yaffs_dev *dev, int nand_chunk,
+				    u8 * buffer, struct yaffs_ext_tags *tags)
+{
+	int realigned_chunk = nand_chunk - dev->chunk_offset;
+
+	if (dev->param.read_chunk_tags_fn)
+		return dev->param.read_chunk_tags_fn(dev, realigned_chunk,
+						     buffer, tags);
+	return yaffs_tags_compat_rd(dev, realigned_chunk, buffer, tags);
+}
+
 int yaffs_wr_chunk_tags_nand(struct yaffs_dev *dev,
 			     int nand_chunk,
 			     const u8 * buffer, struct yaffs_ext_tags *tags)
@@ -97,6 +97,9 @@ unsigned int yaffs_wr_attempts = YAFFS_WR_ATTEMPTS;
 unsigned int yaffs_auto_checkpoint = 1;
 unsigned int yaffs_gc_control = 1;
 unsigned int yaffs_bg_enable = 1;
+unsigned int yaffs_n_caches = 32;
+unsigned int yaffs_bg_idle_ms = 500;
+unsigned int yaffs_bg_gc_batch = 4;
 
 /* Module Parameters */
 module_param(yaffs_trace_mask, uint, 0644);
@@ -104,6 +107,9 @@ module_param(yaffs_wr_attempts, uint, 0644);
 module_param(yaffs_auto_checkpoint, uint, 0644);
 module_param(yaffs_gc_control, uint, 0644);
 module_param(yaffs_bg_enable, uint, 0644);
+module_param(yaffs_n_caches, uint, 0644);
+module_param(yaffs_bg_idle_ms, uint, 0644);
+module_param(yaffs_bg_gc_batch, uint, 0644);
 
 
 #define yaffs_inode_to_obj_lv(iptr) ((iptr)->i_private)
@@ -123,15 +129,92 @@ static unsigned yaffs_gc_control_callback(struct yaffs_dev *dev)
 
 static void yaffs_gross_lock(struct yaffs_dev *dev)
 {
+	struct yaffs_linux_context *lc = yaffs_dev_to_lc(dev);
+	unsigned long waited = 0;
+	int contended = 0;
+	int fg = current != lc->bg_thread;
+	ktime_t start;
+
 	yaffs_trace(YAFFS_TRACE_LOCK, "yaffs locking %p", current);
-	mutex_lock(&(yaffs_dev_to_lc(dev)->gross_lock));
+	if (fg)
+		lc->fg_last_active = jiffies;
+	if (!down_write_trylock(&lc->gross_lock)) {
+		start = ktime_get();
+		/* only others waiting make the bg thread yield */
+		if (fg)
+			atomic_inc(&lc->fg_waiters);
+		down_write(&lc->gross_lock);
+		if (fg)
+			atomic_dec(&lc->fg_waiters);
+		lc->gross_lock_taken = ktime_get();
+		waited = ktime_us_delta(lc->gross_lock_taken, start);
+		contended = 1;
+	} else {
+		lc->gross_lock_taken = ktime_get();
+	}
+
+	spin_lock(&lc->stats_lock);
+	lc->lock_stats.acquired++;
+	lc->lock_stats.contended += contended;
+	lc->lock_stats.wait_us += waited;
+	spin_unlock(&lc->stats_lock);
 	yaffs_trace(YAFFS_TRACE_LOCK, "yaffs locked %p", current);
 }
 
 static void yaffs_gross_unlock(struct yaffs_dev *dev)
 {
+	struct yaffs_linux_context *lc = yaffs_dev_to_lc(dev);
+	unsigned long held;
+
+	held = ktime_us_delta(ktime_get(), lc->gross_lock_taken);
+	spin_lock(&lc->stats_lock);
+	lc->lock_stats.hold_us += held;
+	if (held > lc->lock_stats.max_hold_us)
+		lc->lock_stats.max_hold_us = held;
+	spin_unlock(&lc->stats_lock);
+
 	yaffs_trace(YAFFS_TRACE_LOCK, "yaffs unlocking %p", current);
-	mutex_unlock(&(yaffs_dev_to_lc(dev)->gross_lock));
+	up_write(&lc->gross_lock);
+}
+
+/*
+ * Page reads that can be served by yaffs_file_rd_shared() only need to
+ * keep writers out, so they share the gross lock with each other.
+ */
+static void yaffs_gross_lock_shared(struct yaffs_dev *dev)
+{
+	struct yaffs_linux_context *lc = yaffs_dev_to_lc(dev);
+	unsigned long waited = 0;
+	int contended = 0;
+	int fg = current != lc->bg_thread;
+	ktime_t start;
+
+	yaffs_trace(YAFFS_TRACE_LOCK, "yaffs locking shared %p", current);
+	if (fg)
+		lc->fg_last_active = jiffies;
+	if (!down_read_trylock(&lc->gross_lock)) {
+		start = ktime_get();
+		if (fg)
+			atomic_inc(&lc->fg_waiters);
+		down_read(&lc->gross_lock);
+		if (fg)
+			atomic_dec(&lc->fg_waiters);
+		waited = ktime_us_delta(ktime_get(), start);
+		contended = 1;
+	}
+
+	spin_lock(&lc->stats_lock);
+	lc->lock_stats.shared_acquired++;
+	lc->lock_stats.shared_contended += contended;
+	lc->lock_stats.shared_wait_us += waited;
+	spin_unlock(&lc->stats_lock);
+	yaffs_trace(YAFFS_TRACE_LOCK, "yaffs locked shared %p", current);
+}
+
+static void yaffs_gross_unlock_shared(struct yaffs_dev *dev)
+{
+	yaffs_trace(YAFFS_TRACE_LOCK, "yaffs unlocking shared %p", current);
+	up_read(&(yaffs_dev_to_lc(dev)->gross_lock));
 }
 
 static void yaffs_fill_inode_from_obj(struct inode *inode,
@@ -1178,8 +1261,10 @@ static int yaffs_readpage_nolock(struct file *f, struct page *pg)
 	struct yaffs_obj *obj;
 	unsigned char *pg_buf;
 	int ret;
+	struct yaffs_shared_rd_stats stats = { 0 };
 
 	struct yaffs_dev *dev;
+	struct yaffs_linux_context *lc;
 
 	yaffs_trace(YAFFS_TRACE_OS,
 		"yaffs_readpage_nolock at %08x, size %08x",
@@ -1189,18 +1274,40 @@ static int yaffs_readpage_nolock(struct file *f, struct page *pg)
 	obj = yaffs_dentry_to_obj(f->f_dentry);
 
 	dev = obj->my_dev;
+	lc = yaffs_dev_to_lc(dev);
 
 	BUG_ON(!PageLocked(pg));
 
 	pg_buf = kmap(pg);
 	/* FIXME: Can kmap fail? */
 
-	yaffs_gross_lock(dev);
+	yaffs_gross_lock_shared(dev);
 
-	ret = yaffs_file_rd(obj, pg_buf,
-			    pg->index << PAGE_CACHE_SHIFT, PAGE_CACHE_SIZE);
+	ret = yaffs_file_rd_shared(obj, pg_buf,
+				   pg->index << PAGE_CACHE_SHIFT,
+				   PAGE_CACHE_SIZE, &stats);
 
-	yaffs_gross_unlock(dev);
+	/*
+	 * Exclusive holders update these without stats_lock, but they
+	 * cannot run while we hold the lock shared.
+	 */
+	spin_lock(&lc->stats_lock);
+	dev->n_page_reads += stats.page_reads;
+	dev->cache_lookups += stats.cache_lookups;
+	dev->cache_hits += stats.cache_hits;
+	spin_unlock(&lc->stats_lock);
+
+	yaffs_gross_unlock_shared(dev);
+
+	if (ret < 0) {
+		yaffs_gross_lock(dev);
+
+		ret = yaffs_file_rd(obj, pg_buf,
+				    pg->index << PAGE_CACHE_SHIFT,
+				    PAGE_CACHE_SIZE);
+
+		yaffs_gross_unlock(dev);
+	}
 
 	if (ret >= 0)
 		ret = 0;
@@ -1670,8 +1777,10 @@ static int yaffs_bg_thread_fn(void *data)
 	unsigned long next_gc = now;
 	unsigned long expires;
 	unsigned int urgency;
+	unsigned int passes;
+	unsigned int i;
+	int idle;
 
-	int gc_result;
 	struct timer_list timer;
 
 	yaffs_trace(YAFFS_TRACE_BACKGROUND,
@@ -1687,20 +1796,56 @@ static int yaffs_bg_thread_fn(void *data)
 		if (try_to_freeze())
 			continue;
 
-		yaffs_gross_lock(dev);
-
 		now = jiffies;
 
 		if (time_after(now, next_dir_update) && yaffs_bg_enable) {
+			yaffs_gross_lock(dev);
 			yaffs_update_dirty_dirs(dev);
+			yaffs_gross_unlock(dev);
 			next_dir_update = now + HZ;
 		}
 
+		/*
+		 * The lock is dropped between the directory update and the
+		 * gc pass so that waiting readers get in between them.
+		 *
+		 * Unless space is getting tight, gc keeps out of the way
+		 * until nobody has taken the lock for yaffs_bg_idle_ms. Once
+		 * idle it runs up to yaffs_bg_gc_batch passes per wakeup,
+		 * giving up the lock early if a foreground task wants it.
+		 */
 		if (time_after(now, next_gc) && yaffs_bg_enable) {
+			idle = time_after(now, context->fg_last_active +
+					  msecs_to_jiffies(yaffs_bg_idle_ms));
+			yaffs_gross_lock(dev);
 			if (!dev->is_checkpointed) {
 				urgency = yaffs_bg_gc_urgency(dev);
-				gc_result = yaffs_bg_gc(dev, urgency);
-				if (urgency > 1)
+				passes = idle ? max(yaffs_bg_gc_batch, 1U) : 1;
+				if (urgency < 2 && !idle)
+					passes = 0;
+
+				/*
+				 * yaffs_bg_gc()'s result is worked out before
+				 * its pass, so look at the space again after
+				 * each one.
+				 */
+				for (i = 0; i < passes; i++) {
+					context->bg_stats.passes++;
+					yaffs_bg_gc(dev, urgency);
+					urgency = yaffs_bg_gc_urgency(dev);
+					if (!urgency || (urgency < 2 && !idle))
+						break;
+					if (atomic_read(&context->fg_waiters)) {
+						context->bg_stats.yields++;
+						break;
+					}
+				}
+
+				if (!passes) {
+					context->bg_stats.deferred++;
+					next_gc = now + (urgency ? HZ / 10 + 1 :
+							 HZ * 2);
+				} else if (urgency > 1)
 					next_gc = now + HZ / 20 + 1;
 				else if (urgency > 0)
 					next_gc = now + HZ / 10 + 1;
@@ -1713,8 +1858,8 @@ static int yaffs_bg_thread_fn(void *data)
 				 */
 				next_gc = next_dir_update;
                         }
+			yaffs_gross_unlock(dev);
 		}
-		yaffs_gross_unlock(dev);
 		expires = next_dir_update;
 		if (time_before(next_gc, expires))
 			expires = next_gc;
@@ -1804,6 +1949,8 @@ struct yaffs_options {
 	int skip_checkpoint_read;
 	int skip_checkpoint_write;
 	int no_cache;
+	int n_caches;
+	int n_caches_overridden;
 	int tags_ecc_on;
 	int tags_ecc_overridden;
 	int lazy_loading_enabled;
@@ -1859,6 +2006,10 @@ static int yaffs_parse_options(struct yaffs_options *options,
 			options->empty_lost_and_found_overridden = 1;
 		} else if (!strcmp(cur_opt, "no-cache")) {
 			options->no_cache = 1;
+		} else if (!strncmp(cur_opt, "cache-size=", 11)) {
+			options->n_caches =
+			    simple_strtoul(cur_opt + 11, NULL, 10);
+			options->n_caches_overridden = 1;
 		} else if (!strcmp(cur_opt, "no-checkpoint-read")) {
 			options->skip_checkpoint_read = 1;
 		} else if (!strcmp(cur_opt, "no-checkpoint-write")) {
@@ -2261,7 +2412,12 @@ static struct super_block *yaffs_internal_read_super(int yaffs_version,
 	param->chunks_per_block = YAFFS_CHUNKS_PER_BLOCK;
 	param->total_bytes_per_chunk = YAFFS_BYTES_PER_CHUNK;
 	param->n_reserved_blocks = 5;
-	param->n_caches = (options.no_cache) ? 0 : 10;
+	if (options.no_cache)
+		param->n_caches = 0;
+	else if (options.n_caches_overridden)
+		param->n_caches = options.n_caches;
+	else
+		param->n_caches = yaffs_n_caches;
 	param->inband_tags = options.inband_tags;
 
 #ifdef CONFIG_YAFFS_DISABLE_LAZY_LOAD
@@ -2366,7 +2522,10 @@ static struct super_block *yaffs_internal_read_super(int yaffs_version,
 	INIT_LIST_HEAD(&(yaffs_dev_to_lc(dev)->search_contexts));
 	param->remove_obj_fn = yaffs_remove_obj_callback;
 
-	mutex_init(&(yaffs_dev_to_lc(dev)->gross_lock));
+	init_rwsem(&(yaffs_dev_to_lc(dev)->gross_lock));
+	spin_lock_init(&(yaffs_dev_to_lc(dev)->stats_lock));
+	mutex_init(&(yaffs_dev_to_lc(dev)->spare_lock));
+	atomic_set(&(yaffs_dev_to_lc(dev)->fg_waiters), 0);
 
 	yaffs_gross_lock(dev);
 
@@ -2531,6 +2690,14 @@ static char *yaffs_dump_dev_part1(char *buf, struct yaffs_dev *dev)
 	    sprintf(buf, "n_tags_ecc_unfixed.... %u\n",
 		    dev->n_tags_ecc_unfixed);
 	buf += sprintf(buf, "cache_hits............ %u\n", dev->cache_hits);
+	buf += sprintf(buf, "cache_lookups......... %u\n", dev->cache_lookups);
+	buf +=
+	    sprintf(buf, "cache_evictions....... %u\n", dev->cache_evictions);
+	buf += sprintf(buf, "cache_flushes......... %u\n", dev->cache_flushes);
+	buf +=
+	    sprintf(buf, "cache_flushed_chunks.. %u\n",
+		    dev->cache_flushed_chunks);
+	buf += sprintf(buf, "cache_dirty........... %d\n", dev->cache_n_dirty);
 	buf +=
 	    sprintf(buf, "n_deleted_files....... %u\n", dev->n_deleted_files);
 	buf +=
@@ -2541,6 +2708,82 @@ static char *yaffs_dump_dev_part1(char *buf, struct yaffs_dev *dev)
 	return buf;
 }
 
+static char *yaffs_dump_lock_stats(char *buf, struct yaffs_linux_context *lc)
+{
+	struct yaffs_lock_stats stats;
+
+	spin_lock(&lc->stats_lock);
+	stats = lc->lock_stats;
+	spin_unlock(&lc->stats_lock);
+
+	buf += sprintf(buf, "\n");
+	buf += sprintf(buf, "lock_acquired......... %lu\n", stats.acquired);
+	buf += sprintf(buf, "lock_contended........ %lu\n", stats.contended);
+	buf += sprintf(buf, "lock_wait_us.......... %llu\n",
+			(unsigned long long)stats.wait_us);
+	buf += sprintf(buf, "lock_hold_us.......... %llu\n",
+			(unsigned long long)stats.hold_us);
+	buf += sprintf(buf, "lock_max_hold_us...... %lu\n",
+			stats.max_hold_us);
+	buf += sprintf(buf, "lock_shared_acquired.. %lu\n",
+			stats.shared_acquired);
+	buf += sprintf(buf, "lock_shared_contended. %lu\n",
+			stats.shared_contended);
+	buf += sprintf(buf, "lock_shared_wait_us... %llu\n",
+			(unsigned long long)stats.shared_wait_us);
+
+	return buf;
+}
+
+static char *yaffs_dump_mount_stats(char *buf, struct yaffs_dev *dev)
+{
+	buf += sprintf(buf, "\n");
+	buf += sprintf(buf, "mount_from_checkpt.... %d\n",
+			dev->mount_from_checkpt);
+	buf += sprintf(buf, "mount_total_us........ %u\n", dev->mount_total_us);
+	buf +=
+	    sprintf(buf, "mount_checkpt_us...... %u\n", dev->mount_checkpt_us);
+	buf += sprintf(buf, "mount_scan_state_us... %u\n",
+			dev->mount_scan_state_us);
+	buf += sprintf(buf, "mount_scan_us......... %u\n", dev->mount_scan_us);
+	buf += sprintf(buf, "mount_fixup_us........ %u\n", dev->mount_fixup_us);
+	buf += sprintf(buf, "mount_scan_blocks..... %u\n",
+			dev->mount_scan_blocks);
+	buf += sprintf(buf, "mount_scan_chunks..... %u\n",
+			dev->mount_scan_chunks);
+	buf += sprintf(buf, "mount_page_reads...... %u\n",
+			dev->mount_page_reads);
+	buf += sprintf(buf, "checkpt_saves......... %u\n", dev->checkpt_saves);
+	buf += sprintf(buf, "checkpt_save_us....... %llu\n",
+			(unsigned long long)dev->checkpt_save_us);
+	buf += sprintf(buf, "checkpt_save_max_us... %u\n",
+			dev->checkpt_save_max_us);
+	buf += sprintf(buf, "checkpt_save_bytes.... %u\n",
+			dev->checkpt_save_bytes);
+
+	return buf;
+}
+
+static char *yaffs_dump_gc_stats(char *buf, struct yaffs_linux_context *lc)
+{
+	struct yaffs_dev *dev = lc->dev;
+
+	buf += sprintf(buf, "\n");
+	buf += sprintf(buf, "bg_gc_passes.......... %lu\n", lc->bg_stats.passes);
+	buf +=
+	    sprintf(buf, "bg_gc_deferred........ %lu\n", lc->bg_stats.deferred);
+	buf += sprintf(buf, "bg_gc_yields.......... %lu\n", lc->bg_stats.yields);
+	buf += sprintf(buf, "bg_gc_copies.......... %u\n", dev->n_bg_gc_copies);
+	buf += sprintf(buf, "fg_gcs................ %u\n", dev->n_fg_gcs);
+	buf += sprintf(buf, "fg_gc_stall_us........ %llu\n",
+			(unsigned long long)dev->fg_gc_stall_us);
+	buf +=
+	    sprintf(buf, "fg_gc_max_stall_us.... %u\n",
+		    dev->fg_gc_max_stall_us);
+
+	return buf;
+}
+
 static int yaffs_proc_read(char *page,
 			   char **start,
 			   off_t offset, int count, int *eof, void *data)
@@ -2584,8 +2827,11 @@ static int yaffs_proc_read(char *page,
 				    sprintf(buf, "\nDevice %d \"%s\"\n", n,
 					    dev->param.name);
 				buf = yaffs_dump_dev_part0(buf, dev);
+				buf = yaffs_dump_mount_stats(buf, dev);
 			} else {
 				buf = yaffs_dump_dev_part1(buf, dev);
+				buf = yaffs_dump_lock_stats(buf, dc);
+				buf = yaffs_dump_gc_stats(buf, dc);
                         }
 
 			break;
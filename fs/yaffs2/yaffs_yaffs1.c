@@ -41,6 +41,7 @@ int yaffs1_scan(struct yaffs_dev *dev)
 	struct yaffs_shadow_fixer *shadow_fixers = NULL;
 
 	u8 *chunk_data;
+	s64 scan_start = Y_CLOCK_US();
 
 	yaffs_trace(YAFFS_TRACE_SCAN,
 		"yaffs1_scan starts  intstartblk %d intendblk %d...",
@@ -77,10 +78,14 @@ int yaffs1_scan(struct yaffs_dev *dev)
 			yaffs_trace(YAFFS_TRACE_SCAN_DEBUG, "Block empty ");
 			dev->n_erased_blocks++;
 			dev->n_free_chunks += dev->param.chunks_per_block;
+		} else if (state == YAFFS_BLOCK_STATE_NEEDS_SCANNING) {
+			dev->mount_scan_blocks++;
 		}
 		bi++;
 	}
 
+	dev->mount_scan_state_us = Y_CLOCK_US() - scan_start;
+
 	/* For each block.... */
 	for (blk = dev->internal_start_block;
 	     !alloc_failed && blk <= dev->internal_end_block; blk++) {
@@ -100,6 +105,7 @@ int yaffs1_scan(struct yaffs_dev *dev)
 
 			result = yaffs_rd_chunk_tags_nand(dev, chunk, NULL,
 							  &tags);
+			dev->mount_scan_chunks++;
 
 			/* Let's have a good look at this chunk... */
 
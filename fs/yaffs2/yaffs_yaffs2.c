@@ -817,8 +817,19 @@ int yaffs_checkpoint_save(struct yaffs_dev *dev)
 	yaffs_verify_free_chunks(dev);
 
 	if (!dev->is_checkpointed) {
+		s64 start = Y_CLOCK_US();
+		u32 elapsed;
+
 		yaffs2_checkpt_invalidate(dev);
 		yaffs2_wr_checkpt_data(dev);
+
+		elapsed = Y_CLOCK_US() - start;
+		dev->checkpt_saves++;
+		dev->checkpt_save_us += elapsed;
+		if (elapsed > dev->checkpt_save_max_us)
+			dev->checkpt_save_max_us = elapsed;
+		if (dev->is_checkpointed)
+			dev->checkpt_save_bytes = dev->checkpt_byte_count;
 	}
 
 	yaffs_trace(YAFFS_TRACE_CHECKPOINT | YAFFS_TRACE_MOUNT,
@@ -986,6 +997,7 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 	struct yaffs_block_index *block_index = NULL;
 	int alt_block_index = 0;
+	s64 scan_start = Y_CLOCK_US();
 
 	yaffs_trace(YAFFS_TRACE_SCAN,
 		"yaffs2_scan_backwards starts  intstartblk %d intendblk %d...",
@@ -1081,6 +1093,9 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 	yaffs_trace(YAFFS_TRACE_SCAN, "...done");
 
+	dev->mount_scan_state_us = Y_CLOCK_US() - scan_start;
+	dev->mount_scan_blocks = n_to_scan;
+
 	/* Now scan the blocks looking at the data. */
 	start_iter = 0;
 	end_iter = n_to_scan - 1;
@@ -1116,6 +1131,7 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 			result = yaffs_rd_chunk_tags_nand(dev, chunk, NULL,
 							  &tags);
+			dev->mount_scan_chunks++;
 
 			/* Let's have a good look at this chunk... */
 
@@ -18,6 +18,8 @@
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
 #include <linux/list.h>
+#include <linux/ktime.h>
+#include <linux/types.h>
 #endif
 
 /* The early_suspend structure defines suspend and resume hooks to be called
@@ -29,6 +31,9 @@
  * the suspend handlers have already been called without a matching call to the
  * resume handlers, the suspend handler will be called directly from
  * register_early_suspend. This direct call can violate the normal level order.
+ * Handlers that set async may be run concurrently with the other handlers of
+ * the same level, but all handlers of a level still complete before any
+ * handler of the next level is started.
  */
 enum {
 	EARLY_SUSPEND_LEVEL_BLANK_SCREEN = 50,
@@ -41,6 +46,13 @@ struct early_suspend {
 	int level;
 	void (*suspend)(struct early_suspend *h);
 	void (*resume)(struct early_suspend *h);
+	bool async;
+
+	/* duration of the last call to each hook and the longest seen */
+	ktime_t suspend_time;
+	ktime_t max_suspend_time;
+	ktime_t resume_time;
+	ktime_t max_resume_time;
 #endif
 };
 
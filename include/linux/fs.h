@@ -924,6 +924,15 @@ struct file_ra_state {
 	unsigned int ra_pages;		/* Maximum readahead window */
 	unsigned int mmap_miss;		/* Cache miss stat for mmap accesses */
 	loff_t prev_pos;		/* Cache last read() position */
+
+	/* mmap read-around, sized by how much of the last one was used */
+	pgoff_t mmap_start;		/* where the last read-around started */
+	unsigned int mmap_size;		/* # of pages in it */
+	unsigned int mmap_used;		/* # of faults on them since */
+	unsigned int mmap_seq;		/* read-arounds following on the last */
+	unsigned int mmap_rand;		/* read-arounds anywhere else */
+	unsigned long mmap_pages;	/* pages read in by all read-arounds */
+	unsigned long mmap_hits;	/* faults on read-around pages */
 };
 
 /*
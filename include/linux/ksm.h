@@ -24,14 +24,31 @@ int ksm_madvise(struct vm_area_struct *vma, unsigned long start,
 		unsigned long end, int advice, unsigned long *vm_flags);
 int __ksm_enter(struct mm_struct *mm);
 void __ksm_exit(struct mm_struct *mm);
+int ksm_set_merge_auto(struct mm_struct *mm, int enable);
+unsigned long __ksm_auto_vm_flags(struct mm_struct *mm,
+				  unsigned long vm_flags);
 
 static inline int ksm_fork(struct mm_struct *mm, struct mm_struct *oldmm)
 {
+	mm->ksm_rmap_items = 0;
+	mm->ksm_merging_pages = 0;
 	if (test_bit(MMF_VM_MERGEABLE, &oldmm->flags))
 		return __ksm_enter(mm);
 	return 0;
 }
 
+/*
+ * Flags for a new private mapping of @mm: with VM_MERGEABLE added if the
+ * process asked for PR_SET_MEMORY_MERGE.
+ */
+static inline unsigned long ksm_auto_vm_flags(struct mm_struct *mm,
+					      unsigned long vm_flags)
+{
+	if (test_bit(MMF_VM_MERGE_AUTO, &mm->flags))
+		return __ksm_auto_vm_flags(mm, vm_flags);
+	return vm_flags;
+}
+
 static inline void ksm_exit(struct mm_struct *mm)
 {
 	if (test_bit(MMF_VM_MERGEABLE, &mm->flags))
@@ -101,6 +118,17 @@ static inline void ksm_exit(struct mm_struct *mm)
 {
 }
 
+static inline int ksm_set_merge_auto(struct mm_struct *mm, int enable)
+{
+	return -EINVAL;
+}
+
+static inline unsigned long ksm_auto_vm_flags(struct mm_struct *mm,
+					      unsigned long vm_flags)
+{
+	return vm_flags;
+}
+
 static inline int PageKsm(struct page *page)
 {
 	return 0;
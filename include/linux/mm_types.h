@@ -327,6 +327,16 @@ struct mm_struct {
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 	pgtable_t pmd_huge_pte; /* protected by page_table_lock */
 #endif
+#ifdef CONFIG_KSM
+	/* pages ksmd tracks, and pages merged, in this mm: ksm_thread_mutex */
+	unsigned long ksm_rmap_items;
+	unsigned long ksm_merging_pages;
+#endif
+#ifdef CONFIG_PROCESS_RECLAIM
+	/* pages tried and reclaimed through /proc/<pid>/reclaim */
+	unsigned long reclaim_scanned;
+	unsigned long reclaim_reclaimed;
+#endif
 #ifdef CONFIG_CPUMASK_OFFSTACK
 	struct cpumask cpumask_allocation;
 #endif
@@ -12,6 +12,7 @@
 
 #include <linux/mmc/core.h>
 #include <linux/mod_devicetable.h>
+#include <linux/workqueue.h>
 
 struct mmc_cid {
 	unsigned int		manfid;
@@ -60,6 +61,19 @@ struct mmc_ext_csd {
 	unsigned int		sec_trim_mult;	/* Secure trim multiplier  */
 	unsigned int		sec_erase_mult;	/* Secure erase multiplier */
 	unsigned int		trim_timeout;		/* In milliseconds */
+	unsigned int		generic_cmd6_time;	/* Units: ms */
+	unsigned int		cache_size;		/* Units: kb */
+	bool			cache_ctrl;		/* cache enabled */
+	bool			hpi;			/* HPI supported */
+	bool			hpi_en;			/* HPI enabled */
+	unsigned int		hpi_cmd;		/* cmd used as HPI */
+	bool			bkops;			/* BKOPS supported */
+	bool			bkops_en;		/* BKOPS enabled */
+	u8			raw_bkops_status;	/* 246 */
+	u8			raw_exception_status;	/* 54 */
+	u8			max_packed_writes;	/* 500 */
+	unsigned int		data_sector_size;	/* 512 bytes or 4KB */
+	bool			packed_event_en;	/* packed failure events */
 	bool			enhanced_area_en;	/* enable bit */
 	unsigned long long	enhanced_area_offset;	/* Units: Byte */
 	unsigned int		enhanced_area_size;	/* Units: KB */
@@ -79,6 +93,16 @@ struct mmc_ext_csd {
 	u8			raw_sectors[4];		/* 212 - 4 bytes */
 };
 
+struct mmc_bkops_stats {
+	unsigned int		idle_starts;	/* started while idle */
+	unsigned int		urgent_runs;	/* run for an exception event */
+	unsigned int		level[4];	/* status level when started */
+	unsigned int		interrupted;	/* stopped with HPI */
+	unsigned int		completed;	/* done before next request */
+	unsigned int		errors;		/* failed to start or stop */
+	u64			busy_ms;	/* time spent doing BKOPS */
+};
+
 struct sd_scr {
 	unsigned char		sda_vsn;
 	unsigned char		sda_spec3;
@@ -177,6 +201,8 @@ struct mmc_card {
 #define MMC_STATE_HIGHSPEED_DDR (1<<4)		/* card is in high speed mode */
 #define MMC_STATE_ULTRAHIGHSPEED (1<<5)		/* card is in ultra high speed mode */
 #define MMC_CARD_SDXC		(1<<6)		/* card is SDXC */
+#define MMC_STATE_DOING_BKOPS	(1<<7)		/* card is doing BKOPS */
+#define MMC_STATE_NEED_BKOPS	(1<<8)		/* card raised urgent BKOPS */
 	unsigned int		quirks; 	/* card quirks */
 #define MMC_QUIRK_LENIENT_FN0	(1<<0)		/* allow SDIO FN0 writes outside of the VS CCCR range */
 #define MMC_QUIRK_BLKSZ_FOR_BYTE_MODE (1<<1)	/* use func->cur_blksize */
@@ -216,6 +242,11 @@ struct mmc_card {
 	unsigned int		sd_bus_speed;	/* Bus Speed Mode set for the card */
 
 	struct dentry		*debugfs_root;
+
+	struct delayed_work	bkops_work;	/* idle time BKOPS */
+	unsigned int		bkops_idle_ms;	/* idle time before BKOPS */
+	unsigned long		bkops_start;	/* jiffies at BKOPS start */
+	struct mmc_bkops_stats	bkops_stats;
 };
 
 /*
@@ -314,6 +345,8 @@ static inline void __maybe_unused remove_quirk(struct mmc_card *card, int data)
 #define mmc_card_ddr_mode(c)	((c)->state & MMC_STATE_HIGHSPEED_DDR)
 #define mmc_sd_card_uhs(c) ((c)->state & MMC_STATE_ULTRAHIGHSPEED)
 #define mmc_card_ext_capacity(c) ((c)->state & MMC_CARD_SDXC)
+#define mmc_card_doing_bkops(c)	((c)->state & MMC_STATE_DOING_BKOPS)
+#define mmc_card_need_bkops(c)	((c)->state & MMC_STATE_NEED_BKOPS)
 
 #define mmc_card_set_present(c)	((c)->state |= MMC_STATE_PRESENT)
 #define mmc_card_set_readonly(c) ((c)->state |= MMC_STATE_READONLY)
@@ -322,6 +355,10 @@ static inline void __maybe_unused remove_quirk(struct mmc_card *card, int data)
 #define mmc_card_set_ddr_mode(c) ((c)->state |= MMC_STATE_HIGHSPEED_DDR)
 #define mmc_sd_card_set_uhs(c) ((c)->state |= MMC_STATE_ULTRAHIGHSPEED)
 #define mmc_card_set_ext_capacity(c) ((c)->state |= MMC_CARD_SDXC)
+#define mmc_card_set_doing_bkops(c) ((c)->state |= MMC_STATE_DOING_BKOPS)
+#define mmc_card_clr_doing_bkops(c) ((c)->state &= ~MMC_STATE_DOING_BKOPS)
+#define mmc_card_set_need_bkops(c) ((c)->state |= MMC_STATE_NEED_BKOPS)
+#define mmc_card_clr_need_bkops(c) ((c)->state &= ~MMC_STATE_NEED_BKOPS)
 
 /*
  * Quirk add/remove for MMC products.
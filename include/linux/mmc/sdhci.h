@@ -137,12 +137,22 @@ struct sdhci_host {
 
 	int sg_count;		/* Mapped sg entries */
 
-	u8 *adma_desc;		/* ADMA descriptor table */
-	u8 *align_buffer;	/* Bounce buffer */
+	struct sdhci_adma_page {
+		u8 *desc;		/* Page of ADMA descriptors */
+		dma_addr_t addr;	/* Its bus address */
+	} *adma_pool;		/* Chained ADMA descriptor table */
+	unsigned int adma_pool_pages;
 
-	dma_addr_t adma_addr;	/* Mapped ADMA descr. table */
+	u8 *align_buffer;	/* Bounce buffer */
 	dma_addr_t align_addr;	/* Mapped bounce buffer */
 
+	/* DMA statistics */
+	unsigned long adma_reqs;	/* Transfers done with ADMA */
+	unsigned long adma_segs;	/* sg entries handed to ADMA */
+	unsigned long adma_align_segs;	/* ...that needed an align bounce */
+	unsigned long adma_align_bytes;	/* Bytes bounced for alignment */
+	unsigned long dma_pio_fallbacks;	/* DMA transfers done by PIO */
+
 	struct tasklet_struct card_tasklet;	/* Tasklet structures */
 	struct tasklet_struct finish_tasklet;
 
@@ -183,6 +183,12 @@ enum zone_watermarks {
 #define low_wmark_pages(z) (z->watermark[WMARK_LOW])
 #define high_wmark_pages(z) (z->watermark[WMARK_HIGH])
 
+/*
+ * Highest order cached on the per-cpu lists.  Kernel stacks, network
+ * buffers and ION chunks mostly come in orders 1 to 3.
+ */
+#define PCP_MAX_ORDER		3
+
 struct per_cpu_pages {
 	int count;		/* number of pages in the list */
 	int high;		/* high watermark, emptying needed */
@@ -190,6 +196,10 @@ struct per_cpu_pages {
 
 	/* Lists of pages, one per migrate type stored on the pcp-lists */
 	struct list_head lists[MIGRATE_PCPTYPES];
+
+	/* Blocks of order 1 to PCP_MAX_ORDER, counted in blocks per order */
+	int order_count[PCP_MAX_ORDER];
+	struct list_head order_lists[PCP_MAX_ORDER][MIGRATE_PCPTYPES];
 };
 
 struct per_cpu_pageset {
@@ -348,6 +358,14 @@ struct zone {
 	 */
 	unsigned int		compact_considered;
 	unsigned int		compact_defer_shift;
+
+	/*
+	 * When a kcompactd pass fails to make the zone good for
+	 * sysctl_kcompactd_order, it leaves the zone alone for the next
+	 * 1<<kcompactd_defer_shift wakeups, counted down in kcompactd_skip.
+	 */
+	unsigned int		kcompactd_skip;
+	unsigned int		kcompactd_defer_shift;
 #endif
 
 	ZONE_PADDING(_pad1_)
@@ -372,6 +390,8 @@ struct zone {
 	 */
 	unsigned int inactive_ratio;
 
+	/* Evictions and activations of file pages, see mm/workingset.c */
+	atomic_long_t		inactive_age;
 
 	ZONE_PADDING(_pad2_)
 	/* Rarely used or read-mostly fields */
@@ -102,4 +102,12 @@
 
 #define PR_MCE_KILL_GET 34
 
+/*
+ * Let KSM merge every eligible private mapping of the process, present
+ * and future, without madvise(MADV_MERGEABLE); inherited across fork
+ * and exec.
+ */
+#define PR_SET_MEMORY_MERGE		67
+#define PR_GET_MEMORY_MERGE		68
+
 #endif /* _LINUX_PRCTL_H */
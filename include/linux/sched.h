@@ -435,8 +435,10 @@ extern int get_dumpable(struct mm_struct *mm);
 					/* leave room for more dump flags */
 #define MMF_VM_MERGEABLE	16	/* KSM may merge identical pages */
 #define MMF_VM_HUGEPAGE		17	/* set when VM_HUGEPAGE is set on vma */
+#define MMF_VM_MERGE_AUTO	18	/* KSM registers new private vmas */
 
-#define MMF_INIT_MASK		(MMF_DUMPABLE_MASK | MMF_DUMP_FILTER_MASK)
+#define MMF_INIT_MASK		(MMF_DUMPABLE_MASK | MMF_DUMP_FILTER_MASK |\
+				 (1 << MMF_VM_MERGE_AUTO))
 
 struct sighand_struct {
 	atomic_t		count;
@@ -2008,6 +2010,10 @@ int sched_rt_handler(struct ctl_table *table, int write,
 		void __user *buffer, size_t *lenp,
 		loff_t *ppos);
 
+#ifdef CONFIG_CFS_BANDWIDTH
+extern unsigned int sysctl_sched_cfs_bandwidth_slice;
+#endif
+
 #ifdef CONFIG_SCHED_AUTOGROUP
 extern unsigned int sysctl_sched_autogroup_enabled;
 
@@ -2026,6 +2032,21 @@ static inline void sched_autogroup_fork(struct signal_struct *sig) { }
 static inline void sched_autogroup_exit(struct signal_struct *sig) { }
 #endif
 
+#ifdef CONFIG_CGROUP_TIMER_SLACK
+extern unsigned long task_get_timeout_slack(struct task_struct *tsk,
+					    ktime_t expires);
+extern void task_account_timer_wakeup(struct task_struct *tsk, int hrtimer);
+#else
+static inline unsigned long
+task_get_timeout_slack(struct task_struct *tsk, ktime_t expires)
+{
+	return tsk->timer_slack_ns;
+}
+
+static inline void
+task_account_timer_wakeup(struct task_struct *tsk, int hrtimer) { }
+#endif
+
 #ifdef CONFIG_RT_MUTEXES
 extern int rt_mutex_getprio(struct task_struct *p);
 extern void rt_mutex_setprio(struct task_struct *p, int prio);
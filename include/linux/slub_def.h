@@ -35,6 +35,8 @@ enum stat_item {
 	CMPXCHG_DOUBLE_CPU_FAIL,/* Failure of this_cpu_cmpxchg_double */
 	NR_SLUB_STAT_ITEMS };
 
+#define SLUB_SAMPLE_HIST	11
+
 struct kmem_cache_cpu {
 	void **freelist;	/* Pointer to next available object */
 	unsigned long tid;	/* Globally unique transaction id */
@@ -43,6 +45,12 @@ struct kmem_cache_cpu {
 #ifdef CONFIG_SLUB_STATS
 	unsigned stat[NR_SLUB_STAT_ITEMS];
 #endif
+#ifdef CONFIG_SLUB_SAMPLING
+	unsigned sampled;	/* sampled allocations */
+	unsigned sampled_slow;	/* of which took the slow path */
+	/* slow path latency: < 1us, < 2us, ... < 512us, >= 512us */
+	unsigned slow_hist[SLUB_SAMPLE_HIST];
+#endif
 };
 
 struct kmem_cache_node {
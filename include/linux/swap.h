@@ -171,6 +171,18 @@ enum {
 #define COUNT_CONTINUED	0x80	/* See swap_map continuation for full count */
 #define SWAP_MAP_SHMEM	0xbf	/* Owned by shmem/tmpfs, in first swap_map */
 
+/*
+ * Swap-in readahead policy, set by vm.swap_ra_policy.  With the default
+ * SWAP_RA_POLICY_AUTO, solid state areas (zram among them) use the adaptive
+ * policy and the others the fixed one.
+ */
+enum {
+	SWAP_RA_POLICY_NONE,		/* read only the faulting page */
+	SWAP_RA_POLICY_FIXED,		/* read 1 << page_cluster around it */
+	SWAP_RA_POLICY_ADAPTIVE,	/* size the window by readahead hits */
+	SWAP_RA_POLICY_AUTO,		/* adaptive if SWP_SOLIDSTATE, else fixed */
+};
+
 /*
  * The in-memory structure used to track swap areas.
  */
@@ -194,6 +206,9 @@ struct swap_info_struct {
 	struct block_device *bdev;	/* swap device or bdev of swap file */
 	struct file *swap_file;		/* seldom referenced */
 	unsigned int old_block_size;	/* seldom referenced */
+	unsigned int ra_last_pages;	/* last adaptive readahead window */
+	unsigned long ra_prev_offset;	/* last swap-in, for adaptive */
+	atomic_t ra_hits;		/* readahead pages used since then */
 };
 
 struct swap_list_t {
@@ -243,6 +258,12 @@ static inline void lru_cache_add_file(struct page *page)
 	__lru_cache_add(page, LRU_INACTIVE_FILE);
 }
 
+/* linux/mm/workingset.c */
+extern void workingset_eviction(struct address_space *mapping,
+				struct page *page);
+extern bool workingset_refault(struct address_space *mapping, pgoff_t index);
+extern void workingset_activation(struct page *page);
+
 /* linux/mm/vmscan.c */
 extern unsigned long try_to_free_pages(struct zonelist *zonelist, int order,
 					gfp_t gfp_mask, nodemask_t *mask);
@@ -256,6 +277,10 @@ extern unsigned long mem_cgroup_shrink_node_zone(struct mem_cgroup *mem,
 						unsigned long *nr_scanned);
 extern int __isolate_lru_page(struct page *page, isolate_mode_t mode, int file);
 extern unsigned long shrink_all_memory(unsigned long nr_pages);
+#ifdef CONFIG_PROCESS_RECLAIM
+extern int isolate_lru_page(struct page *page);
+extern unsigned long reclaim_pages_from_list(struct list_head *page_list);
+#endif
 extern int vm_swappiness;
 extern int remove_mapping(struct address_space *mapping, struct page *page);
 extern long vm_total_pages;
@@ -324,6 +349,8 @@ extern void si_swapinfo(struct sysinfo *);
 extern swp_entry_t get_swap_page(void);
 extern swp_entry_t get_swap_page_of_type(int);
 extern int valid_swaphandles(swp_entry_t, unsigned long *);
+extern void swap_readahead_hit(swp_entry_t);
+extern int sysctl_swap_ra_policy;
 extern int add_swap_count_continuation(swp_entry_t, gfp_t);
 extern void swap_shmem_alloc(swp_entry_t);
 extern int swap_duplicate(swp_entry_t);
@@ -0,0 +1,48 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM filemap
+
+#if !defined(_TRACE_FILEMAP_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_FILEMAP_H
+
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+#include <linux/fs.h>
+
+TRACE_EVENT(mm_filemap_mmap_readaround,
+
+	TP_PROTO(struct file *file, pgoff_t offset, unsigned int used,
+		unsigned int size, int sequential),
+
+	TP_ARGS(file, offset, used, size, sequential),
+
+	TP_STRUCT__entry(
+		__field(dev_t, dev)
+		__field(unsigned long, ino)
+		__field(pgoff_t, offset)
+		__field(unsigned int, used)
+		__field(unsigned int, size)
+		__field(int, sequential)
+	),
+
+	TP_fast_assign(
+		__entry->dev = file->f_mapping->host->i_sb->s_dev;
+		__entry->ino = file->f_mapping->host->i_ino;
+		__entry->offset = offset;
+		__entry->used = used;
+		__entry->size = size;
+		__entry->sequential = sequential;
+	),
+
+	TP_printk("dev %d,%d ino %lu offset=%lu used=%u size=%u %s",
+		MAJOR(__entry->dev), MINOR(__entry->dev),
+		__entry->ino,
+		__entry->offset,
+		__entry->used,
+		__entry->size,
+		__entry->sequential ? "sequential" : "random")
+);
+
+#endif /* _TRACE_FILEMAP_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
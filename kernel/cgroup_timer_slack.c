@@ -0,0 +1,221 @@
+/*
+ * cgroup_timer_slack.c - control group timer slack subsystem
+ *
+ * Lets userspace put a floor under the timer slack of every task in a
+ * group, optionally line up the user-requested timeouts of the group so
+ * that they coalesce, and count how many timer wakeups the group takes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include <linux/cgroup.h>
+#include <linux/math64.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+
+struct tslack_cgroup {
+	struct cgroup_subsys_state css;
+	unsigned long min_slack_ns;
+	/* align the latest expiry of the group's timeouts to the slack */
+	int coalesce;
+
+	/* statistics */
+	atomic_long_t hrtimer_wakeups;
+	atomic_long_t timer_wakeups;
+};
+
+static inline struct tslack_cgroup *cgroup_to_tslack(struct cgroup *cgroup)
+{
+	return container_of(cgroup_subsys_state(cgroup, timer_slack_subsys_id),
+			    struct tslack_cgroup, css);
+}
+
+static inline struct tslack_cgroup *task_tslack(struct task_struct *task)
+{
+	return container_of(task_subsys_state(task, timer_slack_subsys_id),
+			    struct tslack_cgroup, css);
+}
+
+static struct cgroup_subsys_state *
+tslack_create(struct cgroup_subsys *ss, struct cgroup *cgroup)
+{
+	struct tslack_cgroup *tslack;
+
+	tslack = kzalloc(sizeof(*tslack), GFP_KERNEL);
+	if (!tslack)
+		return ERR_PTR(-ENOMEM);
+
+	if (cgroup->parent) {
+		struct tslack_cgroup *parent = cgroup_to_tslack(cgroup->parent);
+
+		tslack->min_slack_ns = parent->min_slack_ns;
+		tslack->coalesce = parent->coalesce;
+	}
+
+	return &tslack->css;
+}
+
+static void tslack_destroy(struct cgroup_subsys *ss, struct cgroup *cgroup)
+{
+	kfree(cgroup_to_tslack(cgroup));
+}
+
+/*
+ * The effective slack of a group is the largest min_slack_ns set on it or
+ * any of its ancestors, so a child can never ask for tighter timers than
+ * its parent allows.  Called under rcu_read_lock() or cgroup_mutex.
+ */
+static unsigned long __tslack_effective(struct cgroup *cgroup)
+{
+	unsigned long slack = cgroup_to_tslack(cgroup)->min_slack_ns;
+
+	while (cgroup->parent) {
+		cgroup = cgroup->parent;
+		slack = max(cgroup_to_tslack(cgroup)->min_slack_ns, slack);
+	}
+
+	return slack;
+}
+
+static u64 tslack_read_min(struct cgroup *cgroup, struct cftype *cft)
+{
+	return cgroup_to_tslack(cgroup)->min_slack_ns;
+}
+
+static int tslack_write_min(struct cgroup *cgroup, struct cftype *cft, u64 val)
+{
+	if (val > ULONG_MAX)
+		return -EINVAL;
+
+	cgroup_to_tslack(cgroup)->min_slack_ns = val;
+
+	return 0;
+}
+
+static u64 tslack_read_effective(struct cgroup *cgroup, struct cftype *cft)
+{
+	return __tslack_effective(cgroup);
+}
+
+static u64 tslack_read_coalesce(struct cgroup *cgroup, struct cftype *cft)
+{
+	return cgroup_to_tslack(cgroup)->coalesce;
+}
+
+static int tslack_write_coalesce(struct cgroup *cgroup, struct cftype *cft,
+				 u64 val)
+{
+	if (val > 1)
+		return -EINVAL;
+
+	cgroup_to_tslack(cgroup)->coalesce = val;
+
+	return 0;
+}
+
+static int tslack_stat_show(struct cgroup *cgroup, struct cftype *cft,
+			    struct cgroup_map_cb *cb)
+{
+	struct tslack_cgroup *tslack = cgroup_to_tslack(cgroup);
+
+	cb->fill(cb, "hrtimer_wakeups",
+		 atomic_long_read(&tslack->hrtimer_wakeups));
+	cb->fill(cb, "timer_wakeups",
+		 atomic_long_read(&tslack->timer_wakeups));
+
+	return 0;
+}
+
+static struct cftype files[] = {
+	{
+		.name = "min_slack_ns",
+		.read_u64 = tslack_read_min,
+		.write_u64 = tslack_write_min,
+	},
+	{
+		.name = "effective_slack_ns",
+		.read_u64 = tslack_read_effective,
+	},
+	{
+		.name = "coalesce",
+		.read_u64 = tslack_read_coalesce,
+		.write_u64 = tslack_write_coalesce,
+	},
+	{
+		.name = "stat",
+		.read_map = tslack_stat_show,
+	},
+};
+
+static int tslack_populate(struct cgroup_subsys *ss, struct cgroup *cgroup)
+{
+	return cgroup_add_files(cgroup, ss, files, ARRAY_SIZE(files));
+}
+
+struct cgroup_subsys timer_slack_subsys = {
+	.name		= "timer_slack",
+	.subsys_id	= timer_slack_subsys_id,
+	.create		= tslack_create,
+	.destroy	= tslack_destroy,
+	.populate	= tslack_populate,
+};
+
+/**
+ * task_get_timeout_slack - slack for a timeout requested by @tsk
+ * @tsk: the task sleeping
+ * @expires: absolute expiry time of the timeout
+ *
+ * Only for timeouts userspace asked for: nanosleep, select/poll/epoll
+ * and futex waits.  Returns the larger of the task's own timer_slack_ns
+ * and the effective slack of its timer_slack cgroup.  If the group has
+ * coalescing enabled, the slack is then cut so that the latest expiry
+ * falls on a multiple of it, and timeouts of the group that end within
+ * the same window fire together.
+ */
+unsigned long task_get_timeout_slack(struct task_struct *tsk, ktime_t expires)
+{
+	struct tslack_cgroup *tslack;
+	unsigned long slack;
+	int coalesce;
+	u64 latest;
+
+	rcu_read_lock();
+	tslack = task_tslack(tsk);
+	slack = __tslack_effective(tslack->css.cgroup);
+	coalesce = tslack->coalesce;
+	rcu_read_unlock();
+
+	slack = max(tsk->timer_slack_ns, slack);
+	if (!coalesce || !slack || expires.tv64 < 0)
+		return slack;
+
+	latest = ktime_to_ns(expires) + slack;
+	return slack - (latest - div64_u64(latest, slack) * slack);
+}
+
+/**
+ * task_account_timer_wakeup - charge a timer wakeup to @tsk's group
+ * @tsk: the task being woken
+ * @hrtimer: non-zero if the wakeup came from an hrtimer
+ *
+ * May be called from hard interrupt context.
+ */
+void task_account_timer_wakeup(struct task_struct *tsk, int hrtimer)
+{
+	struct tslack_cgroup *tslack;
+
+	rcu_read_lock();
+	tslack = task_tslack(tsk);
+	if (hrtimer)
+		atomic_long_inc(&tslack->hrtimer_wakeups);
+	else
+		atomic_long_inc(&tslack->timer_wakeups);
+	rcu_read_unlock();
+}
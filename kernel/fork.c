@@ -756,6 +756,10 @@ struct mm_struct *dup_mm(struct task_struct *tsk)
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 	mm->pmd_huge_pte = NULL;
 #endif
+#ifdef CONFIG_PROCESS_RECLAIM
+	mm->reclaim_scanned = 0;
+	mm->reclaim_reclaimed = 0;
+#endif
 
 	if (!mm_init(mm, tsk))
 		goto fail_nomem;
@@ -1503,8 +1503,10 @@ static enum hrtimer_restart hrtimer_wakeup(struct hrtimer *timer)
 	struct task_struct *task = t->task;
 
 	t->task = NULL;
-	if (task)
+	if (task) {
+		task_account_timer_wakeup(task, 1);
 		wake_up_process(task);
+	}
 
 	return HRTIMER_NORESTART;
 }
@@ -1588,14 +1590,18 @@ long hrtimer_nanosleep(struct timespec *rqtp, struct timespec __user *rmtp,
 	struct restart_block *restart;
 	struct hrtimer_sleeper t;
 	int ret = 0;
-	unsigned long slack;
-
-	slack = current->timer_slack_ns;
-	if (rt_task(current))
-		slack = 0;
+	unsigned long slack = 0;
+	ktime_t expires = timespec_to_ktime(*rqtp);
 
 	hrtimer_init_on_stack(&t.timer, clockid, mode);
-	hrtimer_set_expires_range_ns(&t.timer, timespec_to_ktime(*rqtp), slack);
+	if (!rt_task(current)) {
+		ktime_t abs = expires;
+
+		if (mode & HRTIMER_MODE_REL)
+			abs = ktime_add_safe(abs, t.timer.base->get_time());
+		slack = task_get_timeout_slack(current, abs);
+	}
+	hrtimer_set_expires_range_ns(&t.timer, expires, slack);
 	if (do_nanosleep(&t, mode))
 		goto out;
 
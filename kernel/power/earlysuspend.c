@@ -13,10 +13,13 @@
  *
  */
 
+#include <linux/async.h>
+#include <linux/debugfs.h>
 #include <linux/earlysuspend.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/rtc.h>
+#include <linux/seq_file.h>
 #include <linux/syscalls.h> /* sys_sync */
 #include <linux/wakelock.h>
 #include <linux/workqueue.h>
@@ -31,6 +34,10 @@ enum {
 static int debug_mask = DEBUG_USER_STATE;
 module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 
+/* Run handlers that set early_suspend.async concurrently */
+static bool async_enabled = true;
+module_param_named(async, async_enabled, bool, S_IRUGO | S_IWUSR | S_IWGRP);
+
 static DEFINE_MUTEX(early_suspend_lock);
 static LIST_HEAD(early_suspend_handlers);
 static void early_suspend(struct work_struct *work);
@@ -45,6 +52,66 @@ enum {
 };
 static int state;
 
+static LIST_HEAD(early_suspend_domain);
+static ktime_t early_suspend_time;
+static ktime_t late_resume_time;
+
+static void call_handler(struct early_suspend *h, bool resume)
+{
+	ktime_t start, delta;
+
+	if (debug_mask & DEBUG_VERBOSE)
+		pr_info("%s: calling %pf\n",
+			resume ? "late_resume" : "early_suspend",
+			resume ? h->resume : h->suspend);
+
+	start = ktime_get();
+	if (resume)
+		h->resume(h);
+	else
+		h->suspend(h);
+	delta = ktime_sub(ktime_get(), start);
+
+	if (resume) {
+		h->resume_time = delta;
+		if (delta.tv64 > h->max_resume_time.tv64)
+			h->max_resume_time = delta;
+	} else {
+		h->suspend_time = delta;
+		if (delta.tv64 > h->max_suspend_time.tv64)
+			h->max_suspend_time = delta;
+	}
+}
+
+static void async_early_suspend(void *data, async_cookie_t cookie)
+{
+	call_handler(data, false);
+}
+
+static void async_late_resume(void *data, async_cookie_t cookie)
+{
+	call_handler(data, true);
+}
+
+/*
+ * Start one handler, first waiting for any asynchronous handlers of the
+ * previous level to finish. *level tracks the level currently running.
+ */
+static void run_handler(struct early_suspend *h, bool resume, int *level)
+{
+	if (h->level != *level) {
+		async_synchronize_full_domain(&early_suspend_domain);
+		*level = h->level;
+	}
+
+	if (h->async && async_enabled)
+		async_schedule_domain(resume ? async_late_resume :
+				      async_early_suspend,
+				      h, &early_suspend_domain);
+	else
+		call_handler(h, resume);
+}
+
 void register_early_suspend(struct early_suspend *handler)
 {
 	struct list_head *pos;
@@ -76,6 +143,8 @@ static void early_suspend(struct work_struct *work)
 	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
+	int level = INT_MIN;
+	ktime_t start;
 
 	mutex_lock(&early_suspend_lock);
 	spin_lock_irqsave(&state_lock, irqflags);
@@ -94,13 +163,13 @@ static void early_suspend(struct work_struct *work)
 
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("early_suspend: call handlers\n");
+	start = ktime_get();
 	list_for_each_entry(pos, &early_suspend_handlers, link) {
-		if (pos->suspend != NULL) {
-			if (debug_mask & DEBUG_VERBOSE)
-				pr_info("early_suspend: calling %pf\n", pos->suspend);
-			pos->suspend(pos);
-		}
+		if (pos->suspend != NULL)
+			run_handler(pos, false, &level);
 	}
+	async_synchronize_full_domain(&early_suspend_domain);
+	early_suspend_time = ktime_sub(ktime_get(), start);
 	mutex_unlock(&early_suspend_lock);
 
 	if (debug_mask & DEBUG_SUSPEND)
@@ -119,6 +188,8 @@ static void late_resume(struct work_struct *work)
 	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
+	int level = INT_MIN;
+	ktime_t start;
 
 	mutex_lock(&early_suspend_lock);
 	spin_lock_irqsave(&state_lock, irqflags);
@@ -135,14 +206,13 @@ static void late_resume(struct work_struct *work)
 	}
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: call handlers\n");
+	start = ktime_get();
 	list_for_each_entry_reverse(pos, &early_suspend_handlers, link) {
-		if (pos->resume != NULL) {
-			if (debug_mask & DEBUG_VERBOSE)
-				pr_info("late_resume: calling %pf\n", pos->resume);
-
-			pos->resume(pos);
-		}
+		if (pos->resume != NULL)
+			run_handler(pos, true, &level);
 	}
+	async_synchronize_full_domain(&early_suspend_domain);
+	late_resume_time = ktime_sub(ktime_get(), start);
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: done\n");
 abort:
@@ -185,3 +255,54 @@ suspend_state_t get_suspend_state(void)
 {
 	return requested_suspend_state;
 }
+
+#ifdef CONFIG_DEBUG_FS
+static int early_suspend_debug_show(struct seq_file *s, void *data)
+{
+	struct early_suspend *h;
+
+	mutex_lock(&early_suspend_lock);
+	seq_printf(s, "early_suspend %lld us, late_resume %lld us\n\n",
+		   ktime_to_us(early_suspend_time),
+		   ktime_to_us(late_resume_time));
+	seq_printf(s, "level async suspend_us  max_us resume_us  max_us handler\n");
+	list_for_each_entry(h, &early_suspend_handlers, link)
+		seq_printf(s, "%5d %5d %10lld %7lld %9lld %7lld %pf\n",
+			   h->level, h->async,
+			   ktime_to_us(h->suspend_time),
+			   ktime_to_us(h->max_suspend_time),
+			   ktime_to_us(h->resume_time),
+			   ktime_to_us(h->max_resume_time),
+			   h->suspend ? h->suspend : h->resume);
+	mutex_unlock(&early_suspend_lock);
+	return 0;
+}
+
+static int early_suspend_debug_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, early_suspend_debug_show, NULL);
+}
+
+static const struct file_operations early_suspend_debug_fops = {
+	.open		= early_suspend_debug_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init early_suspend_debug_init(void)
+{
+	struct dentry *d;
+
+	d = debugfs_create_file("early_suspend", 0444, NULL, NULL,
+		&early_suspend_debug_fops);
+	if (!d) {
+		pr_err("Failed to create early_suspend debug file\n");
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+late_initcall(early_suspend_debug_init);
+#endif
@@ -15,6 +15,7 @@
 
 #include <linux/module.h>
 #include <linux/platform_device.h>
+#include <linux/rbtree.h>
 #include <linux/rtc.h>
 #include <linux/suspend.h>
 #include <linux/syscalls.h> /* sys_sync */
@@ -42,7 +43,14 @@ module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 
 static DEFINE_SPINLOCK(list_lock);
 static LIST_HEAD(inactive_locks);
+/*
+ * Active locks without a timeout are kept on active_wake_locks[type].
+ * Active locks with a timeout are kept in timed_wake_locks[type], sorted by
+ * expiry, so the next lock to expire and the last one are found without
+ * walking every active lock.
+ */
 static struct list_head active_wake_locks[WAKE_LOCK_TYPE_COUNT];
+static struct rb_root timed_wake_locks[WAKE_LOCK_TYPE_COUNT];
 static int current_event_num;
 struct workqueue_struct *suspend_work_queue;
 struct wake_lock main_wake_lock;
@@ -55,6 +63,46 @@ static struct wake_lock suspend_backoff_lock;
 
 static unsigned suspend_short_count;
 
+#define for_each_timed_wake_lock(lock, pos, type)			\
+	for (pos = rb_first(&timed_wake_locks[type]);			\
+	     pos && ((lock) = rb_entry(pos, struct wake_lock, node));	\
+	     pos = rb_next(pos))
+
+static inline int wake_lock_timed(struct wake_lock *lock)
+{
+	return (lock->flags & (WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE)) ==
+		(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
+}
+
+static void enqueue_timed_wake_lock(struct wake_lock *lock, int type)
+{
+	struct rb_node **link = &timed_wake_locks[type].rb_node;
+	struct rb_node *parent = NULL;
+	struct wake_lock *entry;
+
+	while (*link) {
+		parent = *link;
+		entry = rb_entry(parent, struct wake_lock, node);
+		if (time_before(lock->expires, entry->expires))
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+	rb_link_node(&lock->node, parent, link);
+	rb_insert_color(&lock->node, &timed_wake_locks[type]);
+}
+
+/* Take a lock off whichever list or tree it is on; flags are not changed */
+static void unlink_wake_lock(struct wake_lock *lock)
+{
+	if (wake_lock_timed(lock)) {
+		rb_erase(&lock->node,
+			 &timed_wake_locks[lock->flags & WAKE_LOCK_TYPE_MASK]);
+		RB_CLEAR_NODE(&lock->node);
+	} else
+		list_del(&lock->link);
+}
+
 #ifdef CONFIG_WAKELOCK_STAT
 static struct wake_lock deleted_wake_locks;
 static ktime_t last_sleep_time_update;
@@ -112,30 +160,36 @@ static int print_lock_stat(struct seq_file *m, struct wake_lock *lock)
 	}
 
 	return seq_printf(m,
-		     "\"%s\"\t%d\t%d\t%d\t%lld\t%lld\t%lld\t%lld\t%lld\n",
+		     "\"%s\"\t%d\t%d\t%d\t%lld\t%lld\t%lld\t%lld\t%lld"
+		     "\t%lld\n",
 		     lock->name, lock_count, expire_count,
 		     lock->stat.wakeup_count, ktime_to_ns(active_time),
 		     ktime_to_ns(total_time),
 		     ktime_to_ns(prevent_suspend_time), ktime_to_ns(max_time),
-		     ktime_to_ns(lock->stat.last_time));
+		     ktime_to_ns(lock->stat.last_time),
+		     ktime_to_ns(lock->stat.last_wakeup_time));
 }
 
 static int wakelock_stats_show(struct seq_file *m, void *unused)
 {
 	unsigned long irqflags;
 	struct wake_lock *lock;
+	struct rb_node *pos;
 	int ret;
 	int type;
 
 	spin_lock_irqsave(&list_lock, irqflags);
 
 	ret = seq_puts(m, "name\tcount\texpire_count\twake_count\tactive_since"
-			"\ttotal_time\tsleep_time\tmax_time\tlast_change\n");
+			"\ttotal_time\tsleep_time\tmax_time\tlast_change"
+			"\tlast_wakeup\n");
 	list_for_each_entry(lock, &inactive_locks, link)
 		ret = print_lock_stat(m, lock);
 	for (type = 0; type < WAKE_LOCK_TYPE_COUNT; type++) {
 		list_for_each_entry(lock, &active_wake_locks[type], link)
 			ret = print_lock_stat(m, lock);
+		for_each_timed_wake_lock(lock, pos, type)
+			ret = print_lock_stat(m, lock);
 	}
 	spin_unlock_irqrestore(&list_lock, irqflags);
 	return 0;
@@ -167,29 +221,39 @@ static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 	}
 }
 
+static void update_sleep_wait_stat_locked(struct wake_lock *lock,
+					  ktime_t elapsed, int done)
+{
+	ktime_t etime, add;
+	int expired;
+
+	expired = get_expired_time(lock, &etime);
+	if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND) {
+		if (expired)
+			add = ktime_sub(etime, last_sleep_time_update);
+		else
+			add = elapsed;
+		lock->stat.prevent_suspend_time = ktime_add(
+			lock->stat.prevent_suspend_time, add);
+	}
+	if (done || expired)
+		lock->flags &= ~WAKE_LOCK_PREVENTING_SUSPEND;
+	else
+		lock->flags |= WAKE_LOCK_PREVENTING_SUSPEND;
+}
+
 static void update_sleep_wait_stats_locked(int done)
 {
 	struct wake_lock *lock;
-	ktime_t now, etime, elapsed, add;
-	int expired;
+	struct rb_node *pos;
+	ktime_t now, elapsed;
 
 	now = ktime_get();
 	elapsed = ktime_sub(now, last_sleep_time_update);
-	list_for_each_entry(lock, &active_wake_locks[WAKE_LOCK_SUSPEND], link) {
-		expired = get_expired_time(lock, &etime);
-		if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND) {
-			if (expired)
-				add = ktime_sub(etime, last_sleep_time_update);
-			else
-				add = elapsed;
-			lock->stat.prevent_suspend_time = ktime_add(
-				lock->stat.prevent_suspend_time, add);
-		}
-		if (done || expired)
-			lock->flags &= ~WAKE_LOCK_PREVENTING_SUSPEND;
-		else
-			lock->flags |= WAKE_LOCK_PREVENTING_SUSPEND;
-	}
+	list_for_each_entry(lock, &active_wake_locks[WAKE_LOCK_SUSPEND], link)
+		update_sleep_wait_stat_locked(lock, elapsed, done);
+	for_each_timed_wake_lock(lock, pos, WAKE_LOCK_SUSPEND)
+		update_sleep_wait_stat_locked(lock, elapsed, done);
 	last_sleep_time_update = now;
 }
 #endif
@@ -200,8 +264,8 @@ static void expire_wake_lock(struct wake_lock *lock)
 #ifdef CONFIG_WAKELOCK_STAT
 	wake_unlock_stat_locked(lock, 1);
 #endif
+	unlink_wake_lock(lock);
 	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
-	list_del(&lock->link);
 	list_add(&lock->link, &inactive_locks);
 	if (debug_mask & (DEBUG_WAKE_LOCK | DEBUG_EXPIRE))
 		pr_info("expired wake lock %s\n", lock->name);
@@ -211,42 +275,47 @@ static void expire_wake_lock(struct wake_lock *lock)
 static void print_active_locks(int type)
 {
 	struct wake_lock *lock;
+	struct rb_node *pos;
 	bool print_expired = true;
 
 	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
 	list_for_each_entry(lock, &active_wake_locks[type], link) {
-		if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
-			long timeout = lock->expires - jiffies;
-			if (timeout > 0)
-				pr_info("active wake lock %s, time left %ld\n",
-					lock->name, timeout);
-			else if (print_expired)
-				pr_info("wake lock %s, expired\n", lock->name);
-		} else {
-			pr_info("active wake lock %s\n", lock->name);
-			if (!(debug_mask & DEBUG_EXPIRE))
-				print_expired = false;
-		}
+		pr_info("active wake lock %s\n", lock->name);
+		if (!(debug_mask & DEBUG_EXPIRE))
+			print_expired = false;
+	}
+	for_each_timed_wake_lock(lock, pos, type) {
+		long timeout = lock->expires - jiffies;
+		if (timeout > 0)
+			pr_info("active wake lock %s, time left %ld\n",
+				lock->name, timeout);
+		else if (print_expired)
+			pr_info("wake lock %s, expired\n", lock->name);
 	}
 }
 
 static long has_wake_lock_locked(int type)
 {
-	struct wake_lock *lock, *n;
-	long max_timeout = 0;
+	struct wake_lock *lock;
+	struct rb_node *node;
 
 	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
-	list_for_each_entry_safe(lock, n, &active_wake_locks[type], link) {
-		if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
-			long timeout = lock->expires - jiffies;
-			if (timeout <= 0)
-				expire_wake_lock(lock);
-			else if (timeout > max_timeout)
-				max_timeout = timeout;
-		} else
-			return -1;
+	/* expired locks are at the front of the tree */
+	while ((node = rb_first(&timed_wake_locks[type]))) {
+		lock = rb_entry(node, struct wake_lock, node);
+		if (time_after(lock->expires, jiffies))
+			break;
+		expire_wake_lock(lock);
 	}
-	return max_timeout;
+	if (!list_empty(&active_wake_locks[type]))
+		return -1;
+
+	/* the last lock in the tree is the last one to time out */
+	node = rb_last(&timed_wake_locks[type]);
+	if (!node)
+		return 0;
+	lock = rb_entry(node, struct wake_lock, node);
+	return lock->expires - jiffies;
 }
 
 long has_wake_lock(int type)
@@ -375,10 +444,12 @@ void wake_lock_init(struct wake_lock *lock, int type, const char *name)
 	lock->stat.prevent_suspend_time = ktime_set(0, 0);
 	lock->stat.max_time = ktime_set(0, 0);
 	lock->stat.last_time = ktime_set(0, 0);
+	lock->stat.last_wakeup_time = ktime_set(0, 0);
 #endif
 	lock->flags = (type & WAKE_LOCK_TYPE_MASK) | WAKE_LOCK_INITIALIZED;
 
 	INIT_LIST_HEAD(&lock->link);
+	RB_CLEAR_NODE(&lock->node);
 	spin_lock_irqsave(&list_lock, irqflags);
 	list_add(&lock->link, &inactive_locks);
 	spin_unlock_irqrestore(&list_lock, irqflags);
@@ -396,18 +467,19 @@ void wake_lock_destroy(struct wake_lock *lock)
 	if (lock->stat.count) {
 		deleted_wake_locks.stat.count += lock->stat.count;
 		deleted_wake_locks.stat.expire_count += lock->stat.expire_count;
+		deleted_wake_locks.stat.wakeup_count += lock->stat.wakeup_count;
 		deleted_wake_locks.stat.total_time =
 			ktime_add(deleted_wake_locks.stat.total_time,
 				  lock->stat.total_time);
 		deleted_wake_locks.stat.prevent_suspend_time =
 			ktime_add(deleted_wake_locks.stat.prevent_suspend_time,
 				  lock->stat.prevent_suspend_time);
-		deleted_wake_locks.stat.max_time =
-			ktime_add(deleted_wake_locks.stat.max_time,
-				  lock->stat.max_time);
+		if (lock->stat.max_time.tv64 >
+		    deleted_wake_locks.stat.max_time.tv64)
+			deleted_wake_locks.stat.max_time = lock->stat.max_time;
 	}
 #endif
-	list_del(&lock->link);
+	unlink_wake_lock(lock);
 	spin_unlock_irqrestore(&list_lock, irqflags);
 }
 EXPORT_SYMBOL(wake_lock_destroy);
@@ -429,6 +501,7 @@ static void wake_lock_internal(
 			pr_info("wakeup wake lock: %s\n", lock->name);
 		wait_for_wakeup = 0;
 		lock->stat.wakeup_count++;
+		lock->stat.last_wakeup_time = ktime_get();
 	}
 	if ((lock->flags & WAKE_LOCK_AUTO_EXPIRE) &&
 	    (long)(lock->expires - jiffies) <= 0) {
@@ -436,13 +509,13 @@ static void wake_lock_internal(
 		lock->stat.last_time = ktime_get();
 	}
 #endif
+	unlink_wake_lock(lock);
 	if (!(lock->flags & WAKE_LOCK_ACTIVE)) {
 		lock->flags |= WAKE_LOCK_ACTIVE;
 #ifdef CONFIG_WAKELOCK_STAT
 		lock->stat.last_time = ktime_get();
 #endif
 	}
-	list_del(&lock->link);
 	if (has_timeout) {
 		if (debug_mask & DEBUG_WAKE_LOCK)
 			pr_info("wake_lock: %s, type %d, timeout %ld.%03lu\n",
@@ -450,7 +523,7 @@ static void wake_lock_internal(
 				(timeout % HZ) * MSEC_PER_SEC / HZ);
 		lock->expires = jiffies + timeout;
 		lock->flags |= WAKE_LOCK_AUTO_EXPIRE;
-		list_add_tail(&lock->link, &active_wake_locks[type]);
+		enqueue_timed_wake_lock(lock, type);
 	} else {
 		if (debug_mask & DEBUG_WAKE_LOCK)
 			pr_info("wake_lock: %s, type %d\n", lock->name, type);
@@ -510,8 +583,8 @@ void wake_unlock(struct wake_lock *lock)
 #endif
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_unlock: %s\n", lock->name);
+	unlink_wake_lock(lock);
 	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
-	list_del(&lock->link);
 	list_add(&lock->link, &inactive_locks);
 	if (type == WAKE_LOCK_SUSPEND) {
 		long has_lock = has_wake_lock_locked(type);
@@ -564,8 +637,10 @@ static int __init wakelocks_init(void)
 	int ret;
 	int i;
 
-	for (i = 0; i < ARRAY_SIZE(active_wake_locks); i++)
+	for (i = 0; i < ARRAY_SIZE(active_wake_locks); i++) {
 		INIT_LIST_HEAD(&active_wake_locks[i]);
+		timed_wake_locks[i] = RB_ROOT;
+	}
 
 #ifdef CONFIG_WAKELOCK_STAT
 	wake_lock_init(&deleted_wake_locks, WAKE_LOCK_SUSPEND,
@@ -45,6 +45,7 @@
 #include <linux/syscalls.h>
 #include <linux/kprobes.h>
 #include <linux/user_namespace.h>
+#include <linux/ksm.h>
 
 #include <linux/kmsg_dump.h>
 /* Move somewhere else to avoid recompiling? */
@@ -1804,6 +1805,24 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 			else
 				error = PR_MCE_KILL_DEFAULT;
 			break;
+		case PR_SET_MEMORY_MERGE:
+			if (arg3 | arg4 | arg5)
+				return -EINVAL;
+			if (!capable(CAP_SYS_RESOURCE))
+				return -EPERM;
+			if (!me->mm)
+				return -EINVAL;
+			down_write(&me->mm->mmap_sem);
+			error = ksm_set_merge_auto(me->mm, !!arg2);
+			up_write(&me->mm->mmap_sem);
+			break;
+		case PR_GET_MEMORY_MERGE:
+			if (arg2 | arg3 | arg4 | arg5)
+				return -EINVAL;
+			if (!me->mm)
+				return -EINVAL;
+			error = test_bit(MMF_VM_MERGE_AUTO, &me->mm->flags);
+			break;
 		default:
 			error = -EINVAL;
 			break;
@@ -1407,7 +1407,10 @@ SYSCALL_DEFINE0(getegid)
 
 static void process_timeout(unsigned long __data)
 {
-	wake_up_process((struct task_struct *)__data);
+	struct task_struct *task = (struct task_struct *)__data;
+
+	task_account_timer_wakeup(task, 0);
+	wake_up_process(task);
 }
 
 /**
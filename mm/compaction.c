@@ -14,6 +14,8 @@
 #include <linux/backing-dev.h>
 #include <linux/sysctl.h>
 #include <linux/sysfs.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
 #include "internal.h"
 
 #define CREATE_TRACE_POINTS
@@ -38,6 +40,8 @@ struct compact_control {
 	unsigned int order;		/* order a direct compactor needs */
 	int migratetype;		/* MOVABLE, RECLAIMABLE etc */
 	struct zone *zone;
+
+	unsigned long nr_migrated;	/* Pages migrated so far */
 };
 
 static unsigned long release_freepages(struct list_head *freelist)
@@ -596,6 +600,7 @@ static int compact_zone(struct zone *zone, struct compact_control *cc)
 		update_nr_listpages(cc);
 		nr_remaining = cc->nr_migratepages;
 
+		cc->nr_migrated += nr_migrate - nr_remaining;
 		count_vm_event(COMPACTBLOCKS);
 		count_vm_events(COMPACTPAGES, nr_migrate - nr_remaining);
 		if (nr_remaining)
@@ -758,6 +763,134 @@ int sysctl_extfrag_handler(struct ctl_table *table, int write,
 	return 0;
 }
 
+/*
+ * kcompactd compacts zones in the background, before a high-order
+ * allocation has to stall on direct compaction or fail.  It sleeps until
+ * kswapd goes back to sleep or a high-order allocation fails, then watches
+ * the cpus for KCOMPACTD_INTERVAL.  If they were mostly idle, it looks at
+ * each zone and, where compaction_suitable() says that an allocation of
+ * sysctl_kcompactd_order would fail through fragmentation
+ * (fragmentation_index() above vm.extfrag_threshold), it compacts the
+ * zone asynchronously until such an allocation would succeed.
+ *
+ * The default order is the smallest one the page allocator will not
+ * retry hard for: PAGE_ALLOC_COSTLY_ORDER + 1.  0 turns kcompactd off.
+ */
+int sysctl_kcompactd_order = PAGE_ALLOC_COSTLY_ORDER + 1;
+
+#define KCOMPACTD_INTERVAL	msecs_to_jiffies(1000)
+#define KCOMPACTD_MIN_IDLE	50	/* percent */
+
+static DECLARE_WAIT_QUEUE_HEAD(kcompactd_wait);
+static bool kcompactd_pending;
+
+/*
+ * Called when kswapd goes back to sleep and when a high-order allocation
+ * fails.  Wakeups that arrive while kcompactd is busy are dropped: it is
+ * about to look at every zone anyway.
+ */
+void wakeup_kcompactd(void)
+{
+	if (!sysctl_kcompactd_order || !waitqueue_active(&kcompactd_wait))
+		return;
+	kcompactd_pending = true;
+	wake_up_interruptible(&kcompactd_wait);
+}
+
+static void kcompactd_zone(struct zone *zone, int order)
+{
+	struct compact_control cc = {
+		.nr_freepages = 0,
+		.nr_migratepages = 0,
+		.order = order,
+		.migratetype = MIGRATE_MOVABLE,
+		.zone = zone,
+		.sync = false,
+	};
+	unsigned long start = jiffies;
+
+	if (zone->kcompactd_skip) {
+		zone->kcompactd_skip--;
+		return;
+	}
+	if (compaction_suitable(zone, order) != COMPACT_CONTINUE)
+		return;
+
+	/* Flush pending updates to the LRU lists */
+	lru_add_drain_all();
+
+	INIT_LIST_HEAD(&cc.freepages);
+	INIT_LIST_HEAD(&cc.migratepages);
+
+	count_vm_event(KCOMPACTD_WAKE);
+	compact_zone(zone, &cc);
+	count_vm_events(KCOMPACTD_MIGRATED, cc.nr_migrated);
+	count_vm_events(KCOMPACTD_MSECS, jiffies_to_msecs(jiffies - start));
+
+	if (zone_watermark_ok(zone, order, low_wmark_pages(zone), 0, 0)) {
+		zone->kcompactd_defer_shift = 0;
+		return;
+	}
+	if (zone->kcompactd_defer_shift < COMPACT_MAX_DEFER_SHIFT)
+		zone->kcompactd_defer_shift++;
+	zone->kcompactd_skip = 1U << zone->kcompactd_defer_shift;
+}
+
+static int kcompactd(void *unused)
+{
+	set_freezable();
+	set_user_nice(current, 5);
+
+	while (!kthread_should_stop()) {
+		unsigned long last, elapsed;
+		u64 last_idle, idle;
+		int order;
+		struct zone *zone;
+
+		wait_event_freezable(kcompactd_wait,
+				kcompactd_pending || kthread_should_stop());
+		if (kthread_should_stop())
+			break;
+
+		/* only compact if the cpus stay mostly idle for a while */
+		last = jiffies;
+		last_idle = cpu_idle_jiffies();
+		schedule_timeout_interruptible(KCOMPACTD_INTERVAL);
+		try_to_freeze();
+		kcompactd_pending = false;
+
+		idle = cpu_idle_jiffies();
+		elapsed = (jiffies - last) * num_online_cpus();
+		if (elapsed && (idle - last_idle) * 100 <
+			       (u64)elapsed * KCOMPACTD_MIN_IDLE)
+			continue;
+
+		order = sysctl_kcompactd_order;
+		if (!order)
+			continue;
+
+		for_each_populated_zone(zone) {
+			if (kthread_should_stop())
+				break;
+			kcompactd_zone(zone, order);
+		}
+	}
+	return 0;
+}
+
+static int __init kcompactd_init(void)
+{
+	struct task_struct *task;
+
+	task = kthread_run(kcompactd, NULL, "kcompactd");
+	if (IS_ERR(task)) {
+		printk(KERN_ERR "kcompactd: failed to start\n");
+		return PTR_ERR(task);
+	}
+	return 0;
+}
+module_init(kcompactd_init);
+
 #if defined(CONFIG_SYSFS) && defined(CONFIG_NUMA)
 ssize_t sysfs_compact_node(struct sys_device *dev,
 			struct sysdev_attribute *attr,
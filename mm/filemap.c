@@ -44,6 +44,9 @@
 
 #include <asm/mman.h>
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/filemap.h>
+
 /*
  * Shared mappings implemented 30.11.1994. It's not fully working yet,
  * though.
@@ -500,10 +503,14 @@ int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 
 	ret = add_to_page_cache(page, mapping, offset, gfp_mask);
 	if (ret == 0) {
-		if (page_is_file_cache(page))
-			lru_cache_add_file(page);
-		else
+		if (!page_is_file_cache(page))
 			lru_cache_add_anon(page);
+		else if (workingset_refault(mapping, offset)) {
+			/* evicted too soon: give it a turn on the active list */
+			lru_cache_add_lru(page, LRU_ACTIVE_FILE);
+			workingset_activation(page);
+		} else
+			lru_cache_add_file(page);
 	}
 	return ret;
 }
@@ -1540,6 +1547,54 @@ static int page_cache_read(struct file *file, pgoff_t offset)
 }
 
 #define MMAP_LOTSAMISS  (100)
+#define MMAP_AROUND_MIN	(4UL)
+
+/*
+ * mmap read-around: the window grows when a miss follows straight on from
+ * the last one, which is then read ahead rather than around, or when half
+ * the pages it brought in were faulted on.  It shrinks when fewer than a
+ * quarter were, so that randomly accessed files like APKs are not read a
+ * whole readahead window at a time for every page they touch.
+ */
+static void do_mmap_readaround(struct file_ra_state *ra,
+			       struct address_space *mapping,
+			       struct file *file,
+			       pgoff_t offset)
+{
+	unsigned long limit = max_sane_readahead(ra->ra_pages);
+	unsigned long size = ra->mmap_size;
+	pgoff_t end = ra->mmap_start + size;
+	int sequential = 0;
+
+	if (!size)
+		size = limit;
+	else if (offset >= end && offset < end + size) {
+		sequential = 1;
+		size *= 2;
+	} else if (ra->mmap_used * 2 >= size)
+		size *= 2;
+	else if (ra->mmap_used * 4 < size)
+		size /= 2;
+	size = min(size, limit);
+	size = max(size, min(limit, MMAP_AROUND_MIN));
+
+	trace_mm_filemap_mmap_readaround(file, offset, ra->mmap_used,
+					 size, sequential);
+	if (sequential) {
+		ra->mmap_seq++;
+		ra->start = offset;
+	} else {
+		ra->mmap_rand++;
+		ra->start = max_t(long, 0, offset - size / 2);
+	}
+	ra->size = size;
+	ra->async_size = size / 4;
+
+	ra->mmap_start = ra->start;
+	ra->mmap_size = size;
+	ra->mmap_used = 0;
+	ra->mmap_pages += ra_submit(ra, mapping, file);
+}
 
 /*
  * Synchronous readahead happens when we don't even find
@@ -1550,7 +1605,6 @@ static void do_sync_mmap_readahead(struct vm_area_struct *vma,
 				   struct file *file,
 				   pgoff_t offset)
 {
-	unsigned long ra_pages;
 	struct address_space *mapping = file->f_mapping;
 
 	/* If we don't want any read-ahead, don't bother */
@@ -1576,14 +1630,7 @@ static void do_sync_mmap_readahead(struct vm_area_struct *vma,
 	if (ra->mmap_miss > MMAP_LOTSAMISS)
 		return;
 
-	/*
-	 * mmap read-around
-	 */
-	ra_pages = max_sane_readahead(ra->ra_pages);
-	ra->start = max_t(long, 0, offset - ra_pages / 2);
-	ra->size = ra_pages;
-	ra->async_size = ra_pages / 4;
-	ra_submit(ra, mapping, file);
+	do_mmap_readaround(ra, mapping, file, offset);
 }
 
 /*
@@ -1603,6 +1650,10 @@ static void do_async_mmap_readahead(struct vm_area_struct *vma,
 		return;
 	if (ra->mmap_miss > 0)
 		ra->mmap_miss--;
+	if (offset - ra->mmap_start < ra->mmap_size) {
+		ra->mmap_used++;
+		ra->mmap_hits++;
+	}
 	if (PageReadahead(page))
 		page_cache_async_readahead(mapping, ra, file,
 					   page, offset, ra->ra_pages);
@@ -36,6 +36,7 @@
 #include <linux/hash.h>
 #include <linux/freezer.h>
 #include <linux/oom.h>
+#include <linux/cpumask.h>
 
 #include <asm/tlbflush.h>
 #include "internal.h"
@@ -189,6 +190,25 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Scale the batch below pages_to_scan by merge yield and CPU idleness */
+static unsigned int ksm_adaptive = 1;
+
+/* Batch size chosen from merge yield alone, and after idle scaling */
+static unsigned int ksm_adaptive_rate;
+static unsigned int ksm_adaptive_pages;
+
+/* Idle time and jiffies at the end of the previous batch */
+static u64 ksm_adaptive_last_idle;
+static unsigned long ksm_adaptive_last;
+
+/* Most pages ksmd will track at once, 0 for no limit */
+static unsigned long ksm_max_tracked_pages;
+
+/* Scanner statistics, since boot */
+static unsigned long ksm_pages_scanned;
+static unsigned long ksm_pages_merged;
+static u64 ksm_scan_cpu_ns;
+
 #define KSM_RUN_STOP	0
 #define KSM_RUN_MERGE	1
 #define KSM_RUN_UNMERGE	2
@@ -247,6 +267,7 @@ static inline struct rmap_item *alloc_rmap_item(void)
 static inline void free_rmap_item(struct rmap_item *rmap_item)
 {
 	ksm_rmap_items--;
+	rmap_item->mm->ksm_rmap_items--;
 	rmap_item->mm = NULL;	/* debug safety */
 	kmem_cache_free(rmap_item_cache, rmap_item);
 }
@@ -453,6 +474,7 @@ static void remove_node_from_stable_tree(struct stable_node *stable_node)
 			ksm_pages_sharing--;
 		else
 			ksm_pages_shared--;
+		rmap_item->mm->ksm_merging_pages--;
 		put_anon_vma(rmap_item->anon_vma);
 		rmap_item->address &= PAGE_MASK;
 		cond_resched();
@@ -540,6 +562,7 @@ static void remove_rmap_item_from_tree(struct rmap_item *rmap_item)
 			ksm_pages_sharing--;
 		else
 			ksm_pages_shared--;
+		rmap_item->mm->ksm_merging_pages--;
 
 		put_anon_vma(rmap_item->anon_vma);
 		rmap_item->address &= PAGE_MASK;
@@ -669,11 +692,24 @@ error:
 }
 #endif /* CONFIG_SYSFS */
 
+/*
+ * The checksum only has to notice that a page keeps changing, and every
+ * merge is confirmed by memcmp_pages() anyway, so hash a cache line from
+ * each eighth of the page rather than the whole of it.
+ */
+#define KSM_CHECKSUM_SAMPLES	8
+#define KSM_CHECKSUM_WORDS	(64 / sizeof(u32))
+
 static u32 calc_checksum(struct page *page)
 {
-	u32 checksum;
-	void *addr = kmap_atomic(page, KM_USER0);
-	checksum = jhash2(addr, PAGE_SIZE / 4, 17);
+	u32 checksum = 17;
+	u32 *addr = kmap_atomic(page, KM_USER0);
+	int i;
+
+	for (i = 0; i < KSM_CHECKSUM_SAMPLES; i++)
+		checksum = jhash2(addr + i * (PAGE_SIZE / sizeof(u32) /
+					      KSM_CHECKSUM_SAMPLES),
+				  KSM_CHECKSUM_WORDS, checksum);
 	kunmap_atomic(addr, KM_USER0);
 	return checksum;
 }
@@ -1153,10 +1189,12 @@ static void stable_tree_append(struct rmap_item *rmap_item,
 	rmap_item->address |= STABLE_FLAG;
 	hlist_add_head(&rmap_item->hlist, &stable_node->hlist);
 
-	if (rmap_item->hlist.next)
+	if (rmap_item->hlist.next) {
 		ksm_pages_sharing++;
-	else
+		ksm_pages_merged++;
+	} else
 		ksm_pages_shared++;
+	rmap_item->mm->ksm_merging_pages++;
 }
 
 /*
@@ -1265,6 +1303,7 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	if (rmap_item) {
 		/* It has already been zeroed */
 		rmap_item->mm = mm_slot->mm;
+		rmap_item->mm->ksm_rmap_items++;
 		rmap_item->address = addr;
 		rmap_item->rmap_list = *rmap_list;
 		*rmap_list = rmap_item;
@@ -1272,6 +1311,25 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	return rmap_item;
 }
 
+/*
+ * With max_tracked_pages reached, ksmd keeps scanning the pages it already
+ * tracks but skips those it would need a new rmap_item for.
+ */
+static int ksm_tracking_full(struct rmap_item **rmap_list, unsigned long addr)
+{
+	struct rmap_item *rmap_item = *rmap_list;
+
+	if (!ksm_max_tracked_pages || ksm_rmap_items < ksm_max_tracked_pages)
+		return 0;
+	for (; rmap_item; rmap_item = rmap_item->rmap_list) {
+		if ((rmap_item->address & PAGE_MASK) == addr)
+			return 0;
+		if (rmap_item->address > addr)
+			break;
+	}
+	return 1;
+}
+
 static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 {
 	struct mm_struct *mm;
@@ -1337,8 +1395,10 @@ next_mm:
 				cond_resched();
 				continue;
 			}
-			if (PageAnon(*page) ||
-			    page_trans_compound_anon(*page)) {
+			if ((PageAnon(*page) ||
+			     page_trans_compound_anon(*page)) &&
+			    !ksm_tracking_full(ksm_scan.rmap_list,
+					       ksm_scan.address)) {
 				flush_anon_page(vma, *page, ksm_scan.address);
 				flush_dcache_page(*page);
 				rmap_item = get_next_rmap_item(slot,
@@ -1420,9 +1480,52 @@ static void ksm_do_scan(unsigned int scan_npages)
 		if (!PageKsm(page) || !in_stable_tree(rmap_item))
 			cmp_and_merge_page(page, rmap_item);
 		put_page(page);
+		ksm_pages_scanned++;
 	}
 }
 
+/*
+ * ksm_adapt_scan_rate - pick the size of the next batch
+ * @scanned: pages scanned by the last batch
+ * @merged: pages merged by the last batch
+ * @busy_ns: cpu time ksmd spent on the last batch
+ *
+ * While batches keep finding something to merge the batch doubles, up to
+ * pages_to_scan; while they find nothing it halves, down to a sixteenth
+ * of that.  The result is then scaled by the share of cpu time that was
+ * idle since the last batch, not counting ksmd's own, so ksmd backs off
+ * when the foreground is busy.
+ */
+static void ksm_adapt_scan_rate(unsigned long scanned, unsigned long merged,
+				u64 busy_ns)
+{
+	unsigned int max_pages = ksm_thread_pages_to_scan;
+	unsigned int min_pages = max(max_pages / 16, 1U);
+	unsigned long now = jiffies;
+	unsigned long elapsed = (now - ksm_adaptive_last) * num_online_cpus();
+	u64 idle = cpu_idle_jiffies();
+	u64 idle_delta = idle - ksm_adaptive_last_idle +
+			 nsecs_to_jiffies(busy_ns);
+	unsigned int idle_pct = 100;
+	unsigned int rate = ksm_adaptive_rate;
+
+	if (ksm_adaptive_last && elapsed)
+		idle_pct = min_t(u64, div64_u64(idle_delta * 100, elapsed),
+				 100);
+	ksm_adaptive_last = now;
+	ksm_adaptive_last_idle = idle;
+
+	if (!rate || rate > max_pages)
+		rate = max_pages;
+	if (merged && merged * 64 >= scanned)
+		rate = min(rate * 2, max_pages);
+	else
+		rate = max(rate / 2, min_pages);
+	ksm_adaptive_rate = rate;
+
+	ksm_adaptive_pages = max(rate * idle_pct / 100, min_pages);
+}
+
 static int ksmd_should_run(void)
 {
 	return (ksm_run & KSM_RUN_MERGE) && !list_empty(&ksm_mm_head.mm_list);
@@ -1435,8 +1538,23 @@ static int ksm_scan_thread(void *nothing)
 
 	while (!kthread_should_stop()) {
 		mutex_lock(&ksm_thread_mutex);
-		if (ksmd_should_run())
-			ksm_do_scan(ksm_thread_pages_to_scan);
+		if (ksmd_should_run()) {
+			unsigned long scanned = ksm_pages_scanned;
+			unsigned long merged = ksm_pages_merged;
+			u64 start = task_sched_runtime(current);
+			u64 busy;
+
+			ksm_do_scan(ksm_adaptive && ksm_adaptive_pages ?
+				    ksm_adaptive_pages :
+				    ksm_thread_pages_to_scan);
+
+			busy = task_sched_runtime(current) - start;
+			ksm_scan_cpu_ns += busy;
+			if (ksm_adaptive)
+				ksm_adapt_scan_rate(ksm_pages_scanned - scanned,
+						    ksm_pages_merged - merged,
+						    busy);
+		}
 		mutex_unlock(&ksm_thread_mutex);
 
 		try_to_freeze();
@@ -1495,6 +1613,62 @@ int ksm_madvise(struct vm_area_struct *vma, unsigned long start,
 	return 0;
 }
 
+static inline int ksm_auto_eligible(unsigned long vm_flags)
+{
+	return !(vm_flags & (VM_MERGEABLE | VM_SHARED  | VM_MAYSHARE   |
+			     VM_PFNMAP    | VM_IO      | VM_DONTEXPAND |
+			     VM_RESERVED  | VM_HUGETLB | VM_INSERTPAGE |
+			     VM_NONLINEAR | VM_MIXEDMAP | VM_SAO)) &&
+		(vm_flags & VM_WRITE);
+}
+
+/*
+ * Called with mmap_sem held for writing, before a private mapping is set
+ * up in an mm which asked for PR_SET_MEMORY_MERGE.  Only writable private
+ * mappings are registered: read-only ones rarely hold anonymous pages, and
+ * walking them would cost ksmd time for nothing.
+ */
+unsigned long __ksm_auto_vm_flags(struct mm_struct *mm, unsigned long vm_flags)
+{
+	if (!ksm_auto_eligible(vm_flags))
+		return vm_flags;
+	if (!test_bit(MMF_VM_MERGEABLE, &mm->flags) && __ksm_enter(mm))
+		return vm_flags;
+	return vm_flags | VM_MERGEABLE;
+}
+
+/**
+ * ksm_set_merge_auto - implement PR_SET_MEMORY_MERGE
+ * @mm: the mm, with mmap_sem held for writing
+ * @enable: non-zero to register the mm's mappings, zero to unmerge them
+ *
+ * Enabling marks every eligible mapping VM_MERGEABLE now, and lets
+ * ksm_auto_vm_flags() mark those created later, in this mm and in the
+ * mms it is forked or exec'ed into.  Disabling stops that and unmerges
+ * all of the mm's mergeable mappings, including any madvised ones.
+ */
+int ksm_set_merge_auto(struct mm_struct *mm, int enable)
+{
+	struct vm_area_struct *vma;
+	int advice = enable ? MADV_MERGEABLE : MADV_UNMERGEABLE;
+	int err;
+
+	if (enable)
+		set_bit(MMF_VM_MERGE_AUTO, &mm->flags);
+	else
+		clear_bit(MMF_VM_MERGE_AUTO, &mm->flags);
+
+	for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		if (enable && !ksm_auto_eligible(vma->vm_flags))
+			continue;
+		err = ksm_madvise(vma, vma->vm_start, vma->vm_end, advice,
+				  &vma->vm_flags);
+		if (err)
+			return err;
+	}
+	return 0;
+}
+
 int __ksm_enter(struct mm_struct *mm)
 {
 	struct mm_slot *mm_slot;
@@ -1872,6 +2046,34 @@ static ssize_t pages_to_scan_store(struct kobject *kobj,
 }
 KSM_ATTR(pages_to_scan);
 
+static ssize_t adaptive_show(struct kobject *kobj,
+			     struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_adaptive);
+}
+
+static ssize_t adaptive_store(struct kobject *kobj,
+			      struct kobj_attribute *attr,
+			      const char *buf, size_t count)
+{
+	int err;
+	unsigned long adaptive;
+
+	err = strict_strtoul(buf, 10, &adaptive);
+	if (err || adaptive > 1)
+		return -EINVAL;
+
+	mutex_lock(&ksm_thread_mutex);
+	ksm_adaptive = adaptive;
+	ksm_adaptive_rate = 0;
+	ksm_adaptive_pages = 0;
+	ksm_adaptive_last = 0;
+	mutex_unlock(&ksm_thread_mutex);
+
+	return count;
+}
+KSM_ATTR(adaptive);
+
 static ssize_t run_show(struct kobject *kobj, struct kobj_attribute *attr,
 			char *buf)
 {
@@ -1966,15 +2168,75 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t pages_scanned_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_scanned);
+}
+KSM_ATTR_RO(pages_scanned);
+
+static ssize_t pages_merged_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_merged);
+}
+KSM_ATTR_RO(pages_merged);
+
+static ssize_t scan_cpu_msecs_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%llu\n",
+		       (unsigned long long)div_u64(ksm_scan_cpu_ns,
+						   NSEC_PER_MSEC));
+}
+KSM_ATTR_RO(scan_cpu_msecs);
+
+static ssize_t adaptive_pages_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_adaptive && ksm_adaptive_pages ?
+		       ksm_adaptive_pages : ksm_thread_pages_to_scan);
+}
+KSM_ATTR_RO(adaptive_pages);
+
+static ssize_t max_tracked_pages_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_max_tracked_pages);
+}
+
+static ssize_t max_tracked_pages_store(struct kobject *kobj,
+				       struct kobj_attribute *attr,
+				       const char *buf, size_t count)
+{
+	int err;
+	unsigned long max_pages;
+
+	err = strict_strtoul(buf, 10, &max_pages);
+	if (err)
+		return -EINVAL;
+
+	ksm_max_tracked_pages = max_pages;
+
+	return count;
+}
+KSM_ATTR(max_tracked_pages);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
 	&run_attr.attr,
+	&adaptive_attr.attr,
+	&adaptive_pages_attr.attr,
+	&max_tracked_pages_attr.attr,
 	&pages_shared_attr.attr,
 	&pages_sharing_attr.attr,
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&pages_scanned_attr.attr,
+	&pages_merged_attr.attr,
+	&scan_cpu_msecs_attr.attr,
 	NULL,
 };
 
@@ -30,6 +30,7 @@
 #include <linux/perf_event.h>
 #include <linux/audit.h>
 #include <linux/khugepaged.h>
+#include <linux/ksm.h>
 
 #include <asm/uaccess.h>
 #include <asm/cacheflush.h>
@@ -1238,6 +1239,8 @@ munmap_back:
 			vm_flags |= VM_NORESERVE;
 	}
 
+	vm_flags = ksm_auto_vm_flags(mm, vm_flags);
+
 	/*
 	 * Private writable mapping: check memory availability
 	 */
@@ -2155,6 +2158,7 @@ unsigned long do_brk(unsigned long addr, unsigned long len)
 		return error;
 
 	flags = VM_DATA_DEFAULT_FLAGS | VM_ACCOUNT | mm->def_flags;
+	flags = ksm_auto_vm_flags(mm, flags);
 
 	error = get_unmapped_area(NULL, addr, len, 0, MAP_FIXED);
 	if (error & ~PAGE_MASK)
@@ -651,6 +651,115 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 	spin_unlock(&zone->lock);
 }
 
+/*
+ * Blocks of order 1 to PCP_MAX_ORDER are cached on the pcp lists too, so
+ * that kernel stacks and the like do not take zone->lock every time.  An
+ * order's lists hold about as many pages as the order-0 batch, and never
+ * more than pcp->high allows for the order, which also turns them off for
+ * the boot pagesets and on NOMMU.
+ */
+static inline int pcp_order_high(struct per_cpu_pages *pcp, unsigned int order)
+{
+	return min(2 * max(pcp->batch >> (order + 1), 1), pcp->high >> order);
+}
+
+static inline int pcp_order_batch(struct per_cpu_pages *pcp, unsigned int order)
+{
+	return (pcp_order_high(pcp, order) + 1) / 2;
+}
+
+static inline struct list_head *pcp_order_list(struct per_cpu_pages *pcp,
+					unsigned int order, int migratetype)
+{
+	return &pcp->order_lists[order - 1][migratetype];
+}
+
+/*
+ * Once the zone is below its low watermark, blocks are better off in the
+ * buddy lists where they can merge back into larger ones.
+ */
+static inline bool pcp_order_pressure(struct zone *zone)
+{
+	return zone_page_state(zone, NR_FREE_PAGES) < low_wmark_pages(zone);
+}
+
+/*
+ * Frees count blocks of the given order from the pcp lists, coldest first,
+ * round-robin across the migrate types.
+ */
+static void free_pcp_order_bulk(struct zone *zone, unsigned int order,
+				int count, struct per_cpu_pages *pcp)
+{
+	int migratetype = 0;
+	int to_free = count;
+
+	spin_lock(&zone->lock);
+	zone->all_unreclaimable = 0;
+	zone->pages_scanned = 0;
+
+	while (to_free--) {
+		struct page *page;
+		struct list_head *list;
+
+		do {
+			if (++migratetype == MIGRATE_PCPTYPES)
+				migratetype = 0;
+			list = pcp_order_list(pcp, order, migratetype);
+		} while (list_empty(list));
+
+		page = list_entry(list->prev, struct page, lru);
+		list_del(&page->lru);
+		__free_one_page(page, zone, order, page_private(page));
+		trace_mm_page_pcpu_drain(page, order, page_private(page));
+	}
+	pcp->order_count[order - 1] -= count;
+	__mod_zone_page_state(zone, NR_FREE_PAGES, count << order);
+	spin_unlock(&zone->lock);
+}
+
+static void drain_pcp_orders(struct zone *zone, struct per_cpu_pages *pcp)
+{
+	unsigned int order;
+
+	for (order = 1; order <= PCP_MAX_ORDER; order++)
+		if (pcp->order_count[order - 1])
+			free_pcp_order_bulk(zone, order,
+					pcp->order_count[order - 1], pcp);
+}
+
+/*
+ * Puts a freed block of order 1 to PCP_MAX_ORDER on this cpu's lists.
+ * Returns false if it must go back to the buddy lists instead, in which
+ * case this cpu's blocks of that order are given back as well when the
+ * zone is under pressure.  Called with interrupts disabled.
+ */
+static bool free_pcp_order(struct zone *zone, struct page *page,
+			unsigned int order, int migratetype)
+{
+	struct per_cpu_pages *pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	int high = pcp_order_high(pcp, order);
+
+	if (!high || unlikely(migratetype == MIGRATE_ISOLATE))
+		return false;
+
+	if (pcp_order_pressure(zone)) {
+		if (pcp->order_count[order - 1])
+			free_pcp_order_bulk(zone, order,
+					pcp->order_count[order - 1], pcp);
+		return false;
+	}
+
+	/* As for order-0, RESERVE blocks sit on the MOVABLE list */
+	set_page_private(page, migratetype);
+	if (migratetype >= MIGRATE_PCPTYPES)
+		migratetype = MIGRATE_MOVABLE;
+
+	list_add(&page->lru, pcp_order_list(pcp, order, migratetype));
+	if (++pcp->order_count[order - 1] > high)
+		free_pcp_order_bulk(zone, order, pcp_order_batch(pcp, order), pcp);
+	return true;
+}
+
 static void free_one_page(struct zone *zone, struct page *page, int order,
 				int migratetype)
 {
@@ -691,18 +800,22 @@ static bool free_pages_prepare(struct page *page, unsigned int order)
 
 static void __free_pages_ok(struct page *page, unsigned int order)
 {
+	struct zone *zone = page_zone(page);
 	unsigned long flags;
+	int migratetype;
 	int wasMlocked = __TestClearPageMlocked(page);
 
 	if (!free_pages_prepare(page, order))
 		return;
 
+	migratetype = get_pageblock_migratetype(page);
 	local_irq_save(flags);
 	if (unlikely(wasMlocked))
 		free_page_mlock(page);
 	__count_vm_events(PGFREE, 1 << order);
-	free_one_page(page_zone(page), page, order,
-					get_pageblock_migratetype(page));
+	if (order > PCP_MAX_ORDER ||
+	    !free_pcp_order(zone, page, order, migratetype))
+		free_one_page(zone, page, order, migratetype);
 	local_irq_restore(flags);
 }
 
@@ -1116,6 +1229,7 @@ static void drain_pages(unsigned int cpu)
 			free_pcppages_bulk(zone, pcp->count, pcp);
 			pcp->count = 0;
 		}
+		drain_pcp_orders(zone, pcp);
 		local_irq_restore(flags);
 	}
 }
@@ -1297,6 +1411,40 @@ int split_free_page(struct page *page)
 	return 1 << order;
 }
 
+/*
+ * Takes a block of order 1 to PCP_MAX_ORDER off this cpu's lists, refilling
+ * them from the buddy lists by a batch on a miss, or by just the one block
+ * under pressure.  Called with interrupts disabled.
+ */
+static struct page *rmqueue_pcp_order(struct zone *zone, unsigned int order,
+					int migratetype)
+{
+	struct per_cpu_pages *pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	int batch = pcp_order_batch(pcp, order);
+	struct list_head *list;
+	struct page *page;
+
+	if (!batch)
+		return NULL;
+
+	list = pcp_order_list(pcp, order, migratetype);
+	if (list_empty(list)) {
+		__count_vm_event(PCP_ORDER1_MISS + 2 * (order - 1));
+		if (pcp_order_pressure(zone))
+			batch = 1;
+		pcp->order_count[order - 1] += rmqueue_bulk(zone, order,
+					batch, list, migratetype, 0);
+		if (unlikely(list_empty(list)))
+			return NULL;
+	} else
+		__count_vm_event(PCP_ORDER1_HIT + 2 * (order - 1));
+
+	page = list_entry(list->next, struct page, lru);
+	list_del(&page->lru);
+	pcp->order_count[order - 1]--;
+	return page;
+}
+
 /*
  * Really, prep_compound_page() should be called from __rmqueue_bulk().  But
  * we cheat by calling it from here, in the order > 0 path.  Saves a branch
@@ -1348,12 +1496,19 @@ again:
 			 */
 			WARN_ON_ONCE(order > 1);
 		}
-		spin_lock_irqsave(&zone->lock, flags);
-		page = __rmqueue(zone, order, migratetype);
-		spin_unlock(&zone->lock);
-		if (!page)
-			goto failed;
-		__mod_zone_page_state(zone, NR_FREE_PAGES, -(1 << order));
+		local_irq_save(flags);
+		page = NULL;
+		if (order <= PCP_MAX_ORDER)
+			page = rmqueue_pcp_order(zone, order, migratetype);
+		if (!page) {
+			spin_lock(&zone->lock);
+			page = __rmqueue(zone, order, migratetype);
+			spin_unlock(&zone->lock);
+			if (!page)
+				goto failed;
+			__mod_zone_page_state(zone, NR_FREE_PAGES,
+					      -(1 << order));
+		}
 	}
 
 	__count_zone_vm_events(PGALLOC, zone, 1 << order);
@@ -2298,6 +2453,8 @@ rebalance:
 	}
 
 nopage:
+	if (order)
+		wakeup_kcompactd();
 	warn_alloc_failed(gfp_mask, order, NULL);
 	return page;
 got_pg:
@@ -3649,7 +3806,7 @@ static int zone_batchsize(struct zone *zone)
 static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
 {
 	struct per_cpu_pages *pcp;
-	int migratetype;
+	int migratetype, order;
 
 	memset(p, 0, sizeof(*p));
 
@@ -3657,8 +3814,11 @@ static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
 	pcp->count = 0;
 	pcp->high = 6 * batch;
 	pcp->batch = max(1UL, 1 * batch);
-	for (migratetype = 0; migratetype < MIGRATE_PCPTYPES; migratetype++)
+	for (migratetype = 0; migratetype < MIGRATE_PCPTYPES; migratetype++) {
 		INIT_LIST_HEAD(&pcp->lists[migratetype]);
+		for (order = 1; order <= PCP_MAX_ORDER; order++)
+			INIT_LIST_HEAD(pcp_order_list(pcp, order, migratetype));
+	}
 }
 
 /*
@@ -3766,6 +3926,7 @@ static int __zone_pcp_update(void *data)
 
 		local_irq_save(flags);
 		free_pcppages_bulk(zone, pcp->count, pcp);
+		drain_pcp_orders(zone, pcp);
 		setup_pageset(pset, batch);
 		local_irq_restore(flags);
 	}
@@ -27,6 +27,7 @@
 #include <linux/memory.h>
 #include <linux/math64.h>
 #include <linux/fault-inject.h>
+#include <linux/debugfs.h>
 
 #include <trace/events/kmem.h>
 
@@ -224,6 +225,113 @@ static inline void stat(const struct kmem_cache *s, enum stat_item si)
 #endif
 }
 
+#ifdef CONFIG_SLUB_SAMPLING
+/*
+ * Allocation sampling: every sample_rate'th allocation on a cpu is
+ * recorded in that cpu's ring of the last SLUB_SAMPLES samples, and
+ * counted in its cache's slow path latency histogram.
+ */
+#define SLUB_SAMPLES	256
+
+struct slub_sample {
+	struct kmem_cache *s;	/* NULL once the cache is destroyed */
+	unsigned long addr;	/* call site */
+	unsigned int slow_ns;	/* slow path latency, 0 for the fast path */
+};
+
+struct slub_sample_ring {
+	int countdown;
+	unsigned int head;
+	struct slub_sample sample[SLUB_SAMPLES];
+};
+
+static u32 slub_sample_rate;
+static DEFINE_PER_CPU(struct slub_sample_ring, slub_sample_ring);
+
+static noinline int __sample_alloc(void)
+{
+	struct slub_sample_ring *ring;
+	unsigned long flags;
+	int sample = 0;
+
+	local_irq_save(flags);
+	ring = __this_cpu_ptr(&slub_sample_ring);
+	if (--ring->countdown <= 0) {
+		ring->countdown = slub_sample_rate;
+		sample = 1;
+	}
+	local_irq_restore(flags);
+	return sample;
+}
+
+/* Should this allocation be sampled? */
+static __always_inline int sample_alloc(void)
+{
+	if (likely(!slub_sample_rate))
+		return 0;
+	return __sample_alloc();
+}
+
+static noinline void record_sample(struct kmem_cache *s, unsigned long addr,
+				   u64 slow_start)
+{
+	struct slub_sample_ring *ring;
+	struct slub_sample *sample;
+	struct kmem_cache_cpu *c;
+	unsigned long flags;
+	u64 slow_ns = 0;
+
+	if (slow_start)
+		slow_ns = max_t(u64, local_clock() - slow_start, 1);
+
+	local_irq_save(flags);
+	ring = __this_cpu_ptr(&slub_sample_ring);
+	sample = &ring->sample[ring->head++ % SLUB_SAMPLES];
+	sample->s = s;
+	sample->addr = addr;
+	sample->slow_ns = min_t(u64, slow_ns, UINT_MAX);
+
+	c = __this_cpu_ptr(s->cpu_slab);
+	c->sampled++;
+	if (slow_ns) {
+		c->sampled_slow++;
+		c->slow_hist[min(fls64(slow_ns >> 10), SLUB_SAMPLE_HIST - 1)]++;
+	}
+	local_irq_restore(flags);
+}
+
+/* Called under slub_lock as @s is destroyed: forget its samples */
+static void forget_samples(struct kmem_cache *s)
+{
+	int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		struct slub_sample_ring *ring = &per_cpu(slub_sample_ring, cpu);
+		unsigned long flags;
+
+		local_irq_save(flags);
+		for (i = 0; i < SLUB_SAMPLES; i++)
+			if (ring->sample[i].s == s)
+				ring->sample[i].s = NULL;
+		local_irq_restore(flags);
+	}
+}
+#else
+static inline int sample_alloc(void)
+{
+	return 0;
+}
+
+static inline void record_sample(struct kmem_cache *s, unsigned long addr,
+				 u64 slow_start)
+{
+}
+
+static inline void forget_samples(struct kmem_cache *s)
+{
+}
+#endif /* CONFIG_SLUB_SAMPLING */
+
 /********************************************************************
  * 			Core slab cache functions
  *******************************************************************/
@@ -1919,10 +2027,13 @@ static __always_inline void *slab_alloc(struct kmem_cache *s,
 	void **object;
 	struct kmem_cache_cpu *c;
 	unsigned long tid;
+	int sample;
+	u64 slow_start = 0;
 
 	if (slab_pre_alloc_hook(s, gfpflags))
 		return NULL;
 
+	sample = sample_alloc();
 redo:
 
 	/*
@@ -1943,11 +2054,13 @@ redo:
 	barrier();
 
 	object = c->freelist;
-	if (unlikely(!object || !node_match(c, node)))
+	if (unlikely(!object || !node_match(c, node))) {
 
+		if (unlikely(sample))
+			slow_start = local_clock();
 		object = __slab_alloc(s, gfpflags, node, addr, c);
 
-	else {
+	} else {
 		/*
 		 * The cmpxchg will only match if there was no additional
 		 * operation and if we are on the right processor.
@@ -1971,6 +2084,9 @@ redo:
 		stat(s, ALLOC_FASTPATH);
 	}
 
+	if (unlikely(sample) && object)
+		record_sample(s, addr, slow_start);
+
 	if (unlikely(gfpflags & __GFP_ZERO) && object)
 		memset(object, 0, s->objsize);
 
@@ -2725,6 +2841,7 @@ void kmem_cache_destroy(struct kmem_cache *s)
 		}
 		if (s->flags & SLAB_DESTROY_BY_RCU)
 			rcu_barrier();
+		forget_samples(s);
 		sysfs_slab_remove(s);
 	}
 	up_write(&slub_lock);
@@ -4916,3 +5033,106 @@ static int __init slab_proc_init(void)
 }
 module_init(slab_proc_init);
 #endif /* CONFIG_SLABINFO */
+
+#ifdef CONFIG_SLUB_SAMPLING
+static int slub_samples_show(struct seq_file *m, void *v)
+{
+	int cpu, i;
+
+	down_read(&slub_lock);
+	seq_puts(m, "# cpu cache size slow_ns caller\n");
+	for_each_possible_cpu(cpu) {
+		struct slub_sample_ring *ring = &per_cpu(slub_sample_ring, cpu);
+		unsigned int head = ACCESS_ONCE(ring->head);
+
+		for (i = 0; i < SLUB_SAMPLES; i++) {
+			struct slub_sample sample;
+			unsigned long flags;
+
+			/* a racing record_sample() may tear it: not worth locking */
+			local_irq_save(flags);
+			sample = ring->sample[(head + i) % SLUB_SAMPLES];
+			local_irq_restore(flags);
+			if (!sample.s)
+				continue;
+			seq_printf(m, "%d %s %d %u %pS\n", cpu, sample.s->name,
+				   sample.s->objsize, sample.slow_ns,
+				   (void *)sample.addr);
+		}
+	}
+	up_read(&slub_lock);
+	return 0;
+}
+
+static int slub_latency_show(struct seq_file *m, void *v)
+{
+	struct kmem_cache *s;
+	int cpu, i;
+
+	down_read(&slub_lock);
+	seq_puts(m, "# cache sampled slow <1us <2us <4us <8us <16us <32us "
+		    "<64us <128us <256us <512us >=512us\n");
+	list_for_each_entry(s, &slab_caches, list) {
+		unsigned long sampled = 0, slow = 0;
+		unsigned long hist[SLUB_SAMPLE_HIST] = { 0 };
+
+		for_each_online_cpu(cpu) {
+			struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
+
+			sampled += c->sampled;
+			slow += c->sampled_slow;
+			for (i = 0; i < SLUB_SAMPLE_HIST; i++)
+				hist[i] += c->slow_hist[i];
+		}
+		if (!sampled)
+			continue;
+		seq_printf(m, "%-17s %lu %lu", s->name, sampled, slow);
+		for (i = 0; i < SLUB_SAMPLE_HIST; i++)
+			seq_printf(m, " %lu", hist[i]);
+		seq_putc(m, '\n');
+	}
+	up_read(&slub_lock);
+	return 0;
+}
+
+static int slub_samples_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, slub_samples_show, NULL);
+}
+
+static int slub_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, slub_latency_show, NULL);
+}
+
+static const struct file_operations slub_samples_fops = {
+	.open		= slub_samples_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static const struct file_operations slub_latency_fops = {
+	.open		= slub_latency_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init slub_sampling_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("slub", NULL);
+	if (!dir)
+		return -ENOMEM;
+	debugfs_create_u32("sample_rate", S_IRUGO | S_IWUSR, dir,
+			   &slub_sample_rate);
+	debugfs_create_file("samples", S_IRUSR, dir, NULL,
+			    &slub_samples_fops);
+	debugfs_create_file("latency", S_IRUSR, dir, NULL,
+			    &slub_latency_fops);
+	return 0;
+}
+late_initcall(slub_sampling_init);
+#endif /* CONFIG_SLUB_SAMPLING */
@@ -2116,6 +2116,10 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 			p->flags |= SWP_DISCARDABLE;
 	}
 
+	p->ra_last_pages = 0;
+	p->ra_prev_offset = 0;
+	atomic_set(&p->ra_hits, 0);
+
 	mutex_lock(&swapon_mutex);
 	prio = -1;
 	if (swap_flags & SWAP_FLAG_PREFER)
@@ -2296,6 +2300,61 @@ int swapcache_prepare(swp_entry_t entry)
 	return __swap_duplicate(entry, SWAP_HAS_CACHE);
 }
 
+int sysctl_swap_ra_policy __read_mostly = SWAP_RA_POLICY_AUTO;
+
+/*
+ * Called by lookup_swap_cache() when it finds a page that swapin_readahead()
+ * read ahead of need: credit the hit to the page's swap area.
+ */
+void swap_readahead_hit(swp_entry_t entry)
+{
+	atomic_inc(&swap_info[swp_type(entry)]->ra_hits);
+}
+
+/*
+ * Order of the readahead window for a swap-in at @target.  The adaptive
+ * policy grows the window with the number of readahead pages that were
+ * used since the last swap-in from this area, and with none used reads
+ * ahead only while swap-ins are sequential; it never more than halves the
+ * window at once, so one unlucky fault does not drop it to a single page.
+ * On zram, where each page read ahead costs a decompression, this settles
+ * at no readahead unless the pages really are used.
+ */
+static int swapin_ra_order(struct swap_info_struct *si, pgoff_t target)
+{
+	unsigned int max_pages = 1 << page_cluster;
+	unsigned int pages;
+	int policy = ACCESS_ONCE(sysctl_swap_ra_policy);
+
+	if (policy == SWAP_RA_POLICY_AUTO)
+		policy = (si->flags & SWP_SOLIDSTATE) ?
+			SWAP_RA_POLICY_ADAPTIVE : SWAP_RA_POLICY_FIXED;
+
+	switch (policy) {
+	case SWAP_RA_POLICY_NONE:
+		return 0;
+	case SWAP_RA_POLICY_FIXED:
+		return page_cluster;
+	}
+
+	pages = atomic_xchg(&si->ra_hits, 0) + 2;
+	if (pages == 2) {
+		if (target != si->ra_prev_offset + 1 &&
+		    target != si->ra_prev_offset - 1)
+			pages = 1;
+	} else
+		pages = roundup_pow_of_two(max(pages, 4U));
+	si->ra_prev_offset = target;
+
+	if (pages > max_pages)
+		pages = max_pages;
+	if (pages < si->ra_last_pages / 2)
+		pages = si->ra_last_pages / 2;
+	si->ra_last_pages = pages;
+
+	return ilog2(pages);
+}
+
 /*
  * swap_lock prevents swap_map being freed. Don't grab an extra
  * reference on the swaphandle, it doesn't matter if it becomes unused.
@@ -2303,16 +2362,17 @@ int swapcache_prepare(swp_entry_t entry)
 int valid_swaphandles(swp_entry_t entry, unsigned long *offset)
 {
 	struct swap_info_struct *si;
-	int our_page_cluster = page_cluster;
+	int our_page_cluster;
 	pgoff_t target, toff;
 	pgoff_t base, end;
 	int nr_pages = 0;
 
+	si = swap_info[swp_type(entry)];
+	target = swp_offset(entry);
+	our_page_cluster = swapin_ra_order(si, target);
 	if (!our_page_cluster)	/* no readahead */
 		return 0;
 
-	si = swap_info[swp_type(entry)];
-	target = swp_offset(entry);
 	base = (target >> our_page_cluster) << our_page_cluster;
 	end = base + (1 << our_page_cluster);
 	if (!base)		/* first page is swap header */
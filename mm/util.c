@@ -4,6 +4,7 @@
 #include <linux/module.h>
 #include <linux/err.h>
 #include <linux/sched.h>
+#include <linux/kernel_stat.h>
 #include <asm/uaccess.h>
 
 #include "internal.h"
@@ -239,6 +240,22 @@ void __vma_link_list(struct mm_struct *mm, struct vm_area_struct *vma,
 		next->vm_prev = vma;
 }
 
+/*
+ * Idle and iowait time of all online cpus, in jiffies.  Background
+ * threads such as ksmd and kcompactd sample it to back off while the
+ * foreground is busy.
+ */
+u64 cpu_idle_jiffies(void)
+{
+	u64 idle = 0;
+	int cpu;
+
+	for_each_online_cpu(cpu)
+		idle += cputime64_to_jiffies64(kstat_cpu(cpu).cpustat.idle) +
+			cputime64_to_jiffies64(kstat_cpu(cpu).cpustat.iowait);
+	return idle;
+}
+
 #if defined(CONFIG_MMU) && !defined(HAVE_ARCH_PICK_MMAP_LAYOUT)
 void arch_pick_mmap_layout(struct mm_struct *mm)
 {
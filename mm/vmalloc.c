@@ -572,6 +572,51 @@ void set_iounmap_nonlazy(void)
 	atomic_set(&vmap_lazy_nr, lazy_max_pages()+1);
 }
 
+/*
+ * flush_tlb_kernel_range() invalidates page by page on ARM, so flushing a
+ * purge as one range from its lowest to its highest address can cost far
+ * more than the areas in it, spread as they are over the vmalloc space.
+ * Flush each run of adjacent areas on its own instead, or the whole TLB
+ * once that adds up to more than VMAP_FLUSH_CEILING pages.
+ */
+#define VMAP_FLUSH_CEILING	64
+
+static void flush_purged_vmap_areas(struct list_head *valist, int nr,
+				unsigned long start, unsigned long end)
+{
+	unsigned long run_start = 0, run_end = 0;
+	struct vmap_area *va;
+
+	if (start < end)
+		nr += (end - start) >> PAGE_SHIFT;
+	if (nr > VMAP_FLUSH_CEILING) {
+		flush_tlb_all();
+		count_vm_event(VMAP_FLUSH_ALL);
+		return;
+	}
+
+	if (start < end) {
+		flush_tlb_kernel_range(start, end);
+		count_vm_event(VMAP_FLUSH_RANGE);
+	}
+
+	/* vmap_area_list, and so valist, is sorted by address */
+	list_for_each_entry(va, valist, purge_list) {
+		if (va->va_start != run_end) {
+			if (run_end) {
+				flush_tlb_kernel_range(run_start, run_end);
+				count_vm_event(VMAP_FLUSH_RANGE);
+			}
+			run_start = va->va_start;
+		}
+		run_end = va->va_end;
+	}
+	if (run_end) {
+		flush_tlb_kernel_range(run_start, run_end);
+		count_vm_event(VMAP_FLUSH_RANGE);
+	}
+}
+
 /*
  * Purges all lazily-freed vmap areas.
  *
@@ -589,6 +634,7 @@ static void __purge_vmap_area_lazy(unsigned long *start, unsigned long *end,
 	LIST_HEAD(valist);
 	struct vmap_area *va;
 	struct vmap_area *n_va;
+	unsigned long flush_start = *start, flush_end = *end;
 	int nr = 0;
 
 	/*
@@ -620,11 +666,16 @@ static void __purge_vmap_area_lazy(unsigned long *start, unsigned long *end,
 	}
 	rcu_read_unlock();
 
-	if (nr)
+	if (nr) {
 		atomic_sub(nr, &vmap_lazy_nr);
+		count_vm_event(VMAP_PURGE);
+	}
 
+	/* the caller's own range is only flushed if it asked for it */
+	if (!force_flush)
+		flush_start = flush_end = 0;
 	if (nr || force_flush)
-		flush_tlb_kernel_range(*start, *end);
+		flush_purged_vmap_areas(&valist, nr, flush_start, flush_end);
 
 	if (nr) {
 		spin_lock(&vmap_area_lock);
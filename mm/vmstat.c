@@ -726,12 +726,23 @@ const char * const vmstat_text[] = {
 	"pgpgout",
 	"pswpin",
 	"pswpout",
+	"swap_ra",
+	"swap_ra_hit",
+	"swap_ra_miss",
+	"workingset_refault",
+	"workingset_activate",
 
 	TEXTS_FOR_ZONES("pgalloc")
 
 	"pgfree",
 	"pgactivate",
 	"pgdeactivate",
+	"pcp_order1_hit",
+	"pcp_order1_miss",
+	"pcp_order2_hit",
+	"pcp_order2_miss",
+	"pcp_order3_hit",
+	"pcp_order3_miss",
 
 	"pgfault",
 	"pgmajfault",
@@ -755,6 +766,9 @@ const char * const vmstat_text[] = {
 	"allocstall",
 
 	"pgrotated",
+	"vmap_purge",
+	"vmap_flush_range",
+	"vmap_flush_all",
 
 #ifdef CONFIG_COMPACTION
 	"compact_blocks_moved",
@@ -763,6 +777,9 @@ const char * const vmstat_text[] = {
 	"compact_stall",
 	"compact_fail",
 	"compact_success",
+	"kcompactd_wake",
+	"kcompactd_migrated",
+	"kcompactd_msecs",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
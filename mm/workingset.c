@@ -0,0 +1,207 @@
+/*
+ * mm/workingset.c
+ *
+ * Workingset detection: notice when file pages evicted from the inactive
+ * list are faulted straight back in, and activate them when they are.
+ *
+ * Released under the GPL, see the file COPYING for details.
+ *
+ * Each zone keeps a clock, inactive_age, which ticks whenever a file page
+ * is evicted from or activated off its inactive list.  When reclaim evicts
+ * a page cache page, the clock reading is remembered for it as a shadow
+ * entry.  When the page is read back in, the number of ticks since then
+ * - its refault distance - is the least number of extra inactive slots
+ * it would have needed to stay resident.  If that distance is no larger
+ * than the active list, the page could have stayed in memory at the cost
+ * of a page on the active list, so it is activated straight away to
+ * compete with the pages there, instead of starting again at the tail of
+ * the inactive list where it would only be evicted again.
+ *
+ * This tree's radix tree has no exceptional entries, so the shadow entries
+ * are not left in the page cache slots but in one hash table of small
+ * buckets, keyed by mapping and index, each bucket recycling its oldest
+ * entry.  A shadow outliving its inode may be matched by a new file at the
+ * same address: the worst that does is activate one page.
+ */
+
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/swap.h>
+#include <linux/jhash.h>
+#include <linux/log2.h>
+#include <linux/vmalloc.h>
+#include <linux/vmstat.h>
+
+#define EVICTION_SHIFT	(NODES_SHIFT + ZONES_SHIFT)
+#define EVICTION_MASK	(~0UL >> EVICTION_SHIFT)
+
+/* Fills one cache line on 32-bit, without spinlock debugging */
+#define SHADOW_SLOTS	7
+
+struct shadow_entry {
+	u32 cookie;			/* 0 for an empty slot */
+	unsigned long eviction;		/* clock, node and zone */
+};
+
+struct shadow_bucket {
+	spinlock_t lock;
+	unsigned int hand;		/* next slot to recycle */
+	struct shadow_entry slot[SHADOW_SLOTS];
+};
+
+static struct shadow_bucket *shadow_table;
+static unsigned int shadow_mask;
+
+/* Returns NULL until workingset_init() has set up the table */
+static struct shadow_bucket *shadow_lookup(struct address_space *mapping,
+					   pgoff_t index, u32 *cookie)
+{
+	struct shadow_bucket *table = ACCESS_ONCE(shadow_table);
+	unsigned long key = (unsigned long)mapping;
+	u32 hash;
+
+	if (!table)
+		return NULL;
+	smp_rmb();	/* pairs with smp_wmb() in workingset_init() */
+
+	hash = jhash_3words((u32)key, (u32)(key >> 16 >> 16), (u32)index, 0);
+	*cookie = hash ? hash : 1;
+	return &table[hash & shadow_mask];
+}
+
+static unsigned long pack_shadow(unsigned long eviction, struct zone *zone)
+{
+	eviction = (eviction << NODES_SHIFT) | zone_to_nid(zone);
+	eviction = (eviction << ZONES_SHIFT) | zone_idx(zone);
+	return eviction;
+}
+
+static void unpack_shadow(unsigned long shadow, struct zone **zone,
+			  unsigned long *eviction)
+{
+	int zid;
+
+	zid = shadow & ((1UL << ZONES_SHIFT) - 1);
+	shadow >>= ZONES_SHIFT;
+
+	*zone = NODE_DATA(shadow & ((1UL << NODES_SHIFT) - 1))->node_zones + zid;
+	*eviction = shadow >> NODES_SHIFT;
+}
+
+/**
+ * workingset_eviction - note the eviction of a page cache page
+ * @mapping: address space the page was backing
+ * @page: the page being evicted
+ *
+ * Called by reclaim, under @mapping->tree_lock, as it removes @page from
+ * the page cache.
+ */
+void workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	struct shadow_bucket *bucket;
+	struct shadow_entry *entry;
+	unsigned long eviction;
+	u32 cookie;
+
+	eviction = atomic_long_inc_return(&zone->inactive_age);
+	bucket = shadow_lookup(mapping, page->index, &cookie);
+	if (!bucket)
+		return;
+
+	spin_lock(&bucket->lock);
+	entry = &bucket->slot[bucket->hand];
+	if (++bucket->hand == SHADOW_SLOTS)
+		bucket->hand = 0;
+	entry->cookie = cookie;
+	entry->eviction = pack_shadow(eviction, zone);
+	spin_unlock(&bucket->lock);
+}
+
+/**
+ * workingset_refault - evaluate the refault of a page cache page
+ * @mapping: address space the page is being added to
+ * @index: its index in @mapping
+ *
+ * Consumes the shadow entry left for @index by workingset_eviction(), if
+ * there is one, and returns true if the page should be activated: that is,
+ * if it was evicted less recently than the active file list is long.
+ */
+bool workingset_refault(struct address_space *mapping, pgoff_t index)
+{
+	struct shadow_bucket *bucket;
+	unsigned long eviction = 0;
+	unsigned long refault_distance;
+	struct zone *zone;
+	unsigned long flags;
+	u32 cookie;
+	int i;
+
+	bucket = shadow_lookup(mapping, index, &cookie);
+	if (!bucket)
+		return false;
+
+	/* workingset_eviction() takes it under the irq-safe tree_lock */
+	spin_lock_irqsave(&bucket->lock, flags);
+	for (i = 0; i < SHADOW_SLOTS; i++) {
+		if (bucket->slot[i].cookie == cookie) {
+			bucket->slot[i].cookie = 0;
+			eviction = bucket->slot[i].eviction;
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&bucket->lock, flags);
+	if (i == SHADOW_SLOTS)
+		return false;
+
+	unpack_shadow(eviction, &zone, &eviction);
+	refault_distance = (atomic_long_read(&zone->inactive_age) - eviction) &
+			   EVICTION_MASK;
+
+	count_vm_event(WORKINGSET_REFAULT);
+	if (refault_distance <= zone_page_state(zone, NR_ACTIVE_FILE)) {
+		count_vm_event(WORKINGSET_ACTIVATE);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * workingset_activation - note a page activation
+ * @page: page that is being activated
+ */
+void workingset_activation(struct page *page)
+{
+	atomic_long_inc(&page_zone(page)->inactive_age);
+}
+
+/*
+ * A quarter of memory's worth of shadow entries covers the refault
+ * distances that can lead to activation on any sensible active list,
+ * for about a twentieth of a percent of memory.
+ */
+static int __init workingset_init(void)
+{
+	struct shadow_bucket *table;
+	unsigned long buckets;
+	unsigned long i;
+
+	buckets = totalram_pages / 4 / SHADOW_SLOTS;
+	buckets = rounddown_pow_of_two(max(buckets, 64UL));
+
+	table = vzalloc(buckets * sizeof(struct shadow_bucket));
+	if (!table) {
+		printk(KERN_WARNING "workingset: no memory for shadow table\n");
+		return -ENOMEM;
+	}
+	for (i = 0; i < buckets; i++)
+		spin_lock_init(&table[i].lock);
+	shadow_mask = buckets - 1;
+	smp_wmb();
+	shadow_table = table;
+
+	printk(KERN_INFO "workingset: %lu shadow entries\n",
+	       buckets * SHADOW_SLOTS);
+	return 0;
+}
+module_init(workingset_init);